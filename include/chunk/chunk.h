@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <span>
 #include <string_view>
 #include <string>
 #include <cstdint>
@@ -18,10 +19,12 @@ struct Chunk
 
 	std::shared_ptr<Chunk> parent;
 	std::string name;
-	std::vector<uint8_t> bytes;
-	std::vector<uint8_t>::const_iterator ip;
+	std::vector<uint8_t> bytes; // Written by the compiler
+	std::span<const uint8_t> mapped; // Read in place from a compiled image instead (see image.h)
+	const uint8_t * ip;
 
-	const std::vector<uint8_t> & bytecode(void) { return bytes; }
+	std::span<const uint8_t> bytecode(void) const
+	{ return mapped.empty() ? std::span<const uint8_t>(bytes) : mapped; }
 };
 
 #endif // CHUNK_H
\ No newline at end of file
@@ -10,38 +10,83 @@
 #include "mathobj.h"
 #include "operator.h"
 #include "scope.h"
+#include "session.h"
+#include "ir.h"
+
+// Version of the code generation (the IR passes, the lowering and the builtin operators): it must
+// be bumped by any change to the bytecode compiled from a source, which drops the cached programs
+constexpr uint16_t CODEGEN_VERSION = 1;
 
 class Compiler
 {
 	const AST & ast;
-	std::unique_ptr<OperatorTable> operator_table;
+	std::shared_ptr<OperatorTable> operator_table;
 
-	std::unordered_map<std::string, uint8_t> constant_indices;
+	// Tables of the session (entries are added through it, see `Session::release_input()`)
+	Session & session;
+	std::unordered_map<ConstantKey, uint8_t, ConstantKeyHash> & constant_indices;
+	std::unordered_map<const OperatorFunction *, uint8_t> & operator_indices;
 	std::shared_ptr<std::vector<std::shared_ptr<MathObj>>> constants;
 	std::shared_ptr<std::vector<std::shared_ptr<Variable>>> variables;
 	std::shared_ptr<std::vector<std::shared_ptr<Function>>> functions;
 	std::shared_ptr<std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>> operators;
 
+	size_t first_function; // Index of the first function declared by this input
+
+	std::vector<std::unique_ptr<IRFunction>> ir_functions;
+	IRFunction * ir; // IR function currently being built
+	bool lowering_function_body = false; // Entries used by a function body are kept by the session
+	size_t temporary_count = 0;
+
+	// Function declared but not compiled yet (its body is compiled on the first call)
+	struct PendingFunction
+	{
+		const FunctionDeclarationNode * declaration;
+		std::shared_ptr<Scope> scope; // Scope of the declaration
+	};
+	std::unordered_map<const CustomFunction *, PendingFunction> pending_functions;
+
+	// Operator node waiting for the values of its operands, or an operand to compile (see `compile_expression()`)
+	struct ExpressionFrame
+	{
+		NodeIndex node;
+		bool operands_compiled;
+	};
+	std::vector<ExpressionFrame> expression_stack;
+	std::vector<IRValue> operand_values;
+
 	void emit(uint8_t op_code);
 	void emit(uint8_t op_code, uint8_t arg);
 
-	void compile_block					(const BlockNode * block_n)						;
-	void compile_return_statement		(const ReturnStatementNode * return_statement_n);
-	void compile_function_declaration	(const FunctionDeclarationNode * func_decl_n)	;
-	void compile_function_call			(const FunctionCallNode * func_call_n)			;
-	void compile_parameter				(const ParameterNode * parameter_n)				;
-	void compile_statement				(const ASTNode * statement_n)					;
-	void compile_variable_declaration	(const VariableDeclarationNode * var_decl_n)	;
-	void compile_expression				(const ASTNode * expression_n)					;
-	void compile_operand				(const OperandNode * operand_n)					;
-	void compile_operator				(const OperatorNode * operator_n, bool unary)	;
-	void compile_binary_operator		(const OperatorNode * operator_n)				;
-	void compile_unary_operator			(const OperatorNode * operator_n)				;
-	void compile_identifier				(const IdentifierNode * identifier_n)			;
-	void compile_literal				(const LiteralNode * literal_n)					;
-	void compile_constant				(const LiteralNode * literal_n)					;
+	void	compile_block					(const BlockNode * block_n)						;
+	void	compile_return_statement		(const ReturnStatementNode * return_statement_n);
+	void	compile_function_declaration	(const FunctionDeclarationNode * func_decl_n)	;
+	IRValue	compile_function_call			(const FunctionCallNode * func_call_n)			;
+	void	compile_parameter				(const ParameterNode * parameter_n)				;
+	void	compile_statement				(NodeIndex statement_n)							;
+	void	compile_variable_declaration	(const VariableDeclarationNode * var_decl_n)	;
+	IRValue	compile_expression				(NodeIndex expression_n)						;
+	IRValue	compile_assignment				(const OperatorNode * operator_n, IRValue reference, IRValue value);
+	IRValue	compile_operator				(const OperatorNode * operator_n, std::vector<IRValue> operands, bool unary);
+	IRValue	compile_binary_operator			(const OperatorNode * operator_n, IRValue lhs, IRValue rhs);
+	IRValue	compile_unary_operator			(const OperatorNode * operator_n, IRValue operand);
+	IRValue	compile_identifier				(const IdentifierNode * identifier_n)			;
+	IRValue	compile_reference				(const IdentifierNode * identifier_n)			;
+	IRValue	compile_literal					(const LiteralNode * literal_n)					;
+	IRValue	compile_constant				(const LiteralNode * literal_n)					;
+	uint8_t	find_variable_index				(const IdentifierNode * identifier_n)			;
+
+	// Lowering from IR to bytecode (see `lowering.cpp`)
+	void generate_bytecode(IRFunction & function);
+	void lower(IRFunction & function);
+	void lower_instruction(const IRInstruction & instruction);
+	void lower_constant(const IRInstruction & instruction);
+	void lower_operator(const IRInstruction & instruction, bool unary);
+	uint8_t allocate_temporary(std::vector<uint8_t> & free_slots, const IRInstruction & instruction);
 
 	void register_compile_error(std::string message, std::string additional_info, const ASTNode * node);
+	// The entry of `node` did not fit in a table of the session (see `full_table_node`)
+	void register_full_table(std::string message, const ASTNode * node);
 
 public:
 	enum OpCode
@@ -67,28 +112,37 @@ public:
 	
 	Compiler(
 		const AST & ast,
-		std::unique_ptr<OperatorTable> & operator_table,
-		std::shared_ptr<Scope> & scope,
-		std::shared_ptr<std::vector<std::shared_ptr<MathObj>>> constants,
-		std::shared_ptr<std::vector<std::shared_ptr<Variable>>> variables,
-		std::shared_ptr<std::vector<std::shared_ptr<Function>>> functions,
-		std::shared_ptr<std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>> operators
+		Session & session,
+		std::shared_ptr<Scope> & scope
 	) :
 		ast(ast),
-		operator_table(std::move(operator_table)),
+		operator_table(session.operator_table),
+		session(session),
+		constant_indices(session.constant_indices),
+		operator_indices(session.operator_indices),
+		constants(session.constants),
+		variables(session.variables),
+		functions(session.functions),
+		operators(session.operators),
+		first_function(session.functions->size()),
+		ir(nullptr),
 		scope(scope),
-		chunk(new Chunk("<main>")),
-		constants(std::move(constants)),
-		variables(std::move(variables)),
-		functions(std::move(functions)),
-		operators(std::move(operators))
+		chunk(new Chunk("<main>"))
 	{}
 
 	std::shared_ptr<Scope> scope;
 	std::shared_ptr<Chunk> chunk;
+	// First node (in the source) whose entry did not fit in a full table of constants, variables or
+	// scopes. Their entries are released once an input has run, so fewer statements may fit
+	const ASTNode * full_table_node = nullptr;
 
 	void compile_source(void);
+	// Compile the body of a function on its first call (does nothing if it is already compiled)
+	void compile_function(std::shared_ptr<CustomFunction> function);
+	void compile_pending_functions(void);
 
+	void dump_ir(void);
+	void dump_ir(const IRFunction & function);
 	void disassemble(void);
 	void disassemble(std::shared_ptr<Chunk> & chunk);
 	void print_constant(std::shared_ptr<MathObj> & constant);
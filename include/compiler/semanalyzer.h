@@ -4,10 +4,12 @@
 #include <string>
 #include <memory>
 #include <stack>
+#include <vector>
 
 #include "ast.h"
 #include "mathobj.h"
 #include "scope.h"
+#include "symbol.h"
 
 class SemanticAnalyzer
 {
@@ -35,29 +37,50 @@ public:
 	std::shared_ptr<Scope> scope;
 	
 	SemanticAnalyzer(
-		const AST & ast,
-		std::unique_ptr<OperatorTable> operator_table,
+		AST & ast,
+		std::shared_ptr<OperatorTable> operator_table,
+		std::shared_ptr<SymbolTable> symbols,
 		std::shared_ptr<Scope> & scope
 	) :
 		ast(ast),
 		operator_table(std::move(operator_table)),
+		symbols(std::move(symbols)),
 		scope(scope)
 	{}
 
 	void analyze_source(void);
-	AnalysisResult analyze(ASTNode * node);
+	AnalysisResult analyze(NodeIndex node_index);
 
 	bool in_function(void) const;
 
 private:
-	const AST & ast;
-	std::unique_ptr<OperatorTable> operator_table;
+	AST & ast;
+	std::shared_ptr<OperatorTable> operator_table;
+	std::shared_ptr<SymbolTable> symbols;
 
 	bool panic_mode = false;
 	std::stack<std::pair<ContextType, const ASTNode *>> context_stack;
 
 	void register_semantic_error(std::string message, std::string additional_info, const ASTNode * node);
 
+	// Operator node waiting for the results of its operands, or an operand to analyze
+	struct ExpressionFrame
+	{
+		NodeIndex node;
+		bool operands_analyzed;
+	};
+	std::vector<ExpressionFrame> expression_stack;
+	std::vector<AnalysisResult> operand_results;
+
+	// Walks the operators of an expression with `expression_stack` (chains can be thousands of operators long)
+	AnalysisResult analyze_expression(NodeIndex expression_index);
+	AnalysisResult analyze_binary(ExpressionNode * expr, AnalysisResult left_info, AnalysisResult right_info);
+	AnalysisResult analyze_unary(OperandNode * operand, AnalysisResult operand_info);
+
+	// Purity analysis of the function being analyzed
+	void mark_impure(void);
+	bool is_function_local(SymbolId name) const;
+
 };
 typedef SemanticAnalyzer::ContextType ContextType;
 
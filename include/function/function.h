@@ -1,19 +1,24 @@
 #ifndef FUNCTION_H
 #define FUNCTION_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "chunk.h"
 #include "mathobj.h"
+#include "memo.h"
+#include "symbol.h"
 
 struct Scope;
 struct Function;
-// Represents a multimap of function implementations with the key being the name of the function and its arity
-using FuncImplementations = std::unordered_multimap<std::string, std::shared_ptr<Function>>;
+// Implementations of a function name, in order of declaration
+using FuncImplementations = std::vector<std::shared_ptr<Function>>;
 
-struct Function
+// Functions are shared: the AST only keeps plain pointers to them
+struct Function : public std::enable_shared_from_this<Function>
 {
 	enum class FunctionType
 	{
@@ -36,6 +41,7 @@ struct Function
 	std::string name;
 	std::vector<std::pair<std::string, MathObjType>> parameters;
 	MathObjType return_type;
+	SymbolId signature = NO_SYMBOL; // Name and parameter types (see `SymbolTable::intern_signature()`)
 };
 typedef Function::FunctionType FunctionType;
 
@@ -50,17 +56,28 @@ struct CustomFunction : public Function
 
 	std::shared_ptr<Chunk> chunk;
 	std::shared_ptr<Scope> scope;
+
+	// Set by the semantic analyzer: the result only depends on the arguments (no `print`,
+	// and no use of a non-constant variable declared outside of the function)
+	bool is_pure = true;
+	std::unique_ptr<MemoTable> memo; // Results of previous calls (with `--memoize`)
 };
 
 class FunctionTable
 {
-	FuncImplementations functions;
+	std::unordered_map<SymbolId, FuncImplementations> functions; // Keyed on names
+	std::unordered_map<SymbolId, Function *> signatures; // Keyed on signatures (name, arity and parameter types)
 
 public:
-	std::pair<FuncImplementations::const_iterator, FuncImplementations::const_iterator> get_implementations(std::string_view name) const;
+	const FuncImplementations * get_implementations(SymbolId name) const; // nullptr if there are none
+	Function * find_function(SymbolId signature) const;
+
+	// The signature of `func` must be set
+	void register_function(SymbolId name, std::shared_ptr<Function> func);
 
-	void register_function(std::string name, std::shared_ptr<Function> func);
-	void register_implementation(std::string name, std::shared_ptr<Function> func);
+	// Implementations registered in all the tables so far (see `Scope::resolve_call()`)
+	static inline std::atomic<uint64_t> declarations = 0;
+	void register_implementation(SymbolId name, std::shared_ptr<Function> func);
 
 	//void register_builtin_functions(void);
 };
@@ -0,0 +1,48 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "mathobj.h"
+
+// Bounded table of the results of a pure function, keyed on the values of its arguments.
+// When the table is full, the least recently used result is evicted
+class MemoTable
+{
+public:
+	// Type and bit pattern of each argument value
+	using Key = std::vector<std::pair<MOT, uint64_t>>;
+
+	static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+	MemoTable(size_t capacity = DEFAULT_CAPACITY) :
+		capacity(capacity)
+	{}
+
+	// Build the key of a call (returns false if an argument has no numeric value)
+	static bool make_key(std::vector<std::shared_ptr<MathObj>> & arguments, Key & key);
+
+	// Returns nullptr if the result is not in the table
+	std::shared_ptr<MathObj> find(const Key & key);
+	void insert(Key key, std::shared_ptr<MathObj> result);
+
+	size_t size(void) const { return entries.size(); }
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const Key & key) const;
+	};
+
+	using Entry = std::pair<Key, std::shared_ptr<MathObj>>;
+
+	size_t capacity;
+	std::list<Entry> entries; // Most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+};
+
+#endif // MEMO_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include <string>
 #include <string_view>
 #include <memory>
 
@@ -15,6 +16,18 @@ struct config
 	static bool print_lexer_output;
 	static bool print_parser_output;
 	static bool print_compiler_output;
+	static bool print_ir_output;
+
+	static int optimization_level; // 0, 1 or 2 (`-O<level>`)
+	static bool memoize; // Cache the results of pure functions (`--memoize`)
+	static bool compile_only; // Write a compiled program instead of running the source (`-c`)
+	static std::string prelude; // Run before the program or the REPL (`--prelude <file>`)
+	static bool stream; // Run the file a few statements at a time (`--stream`)
+	static bool pipeline; // Same, scanning and parsing on other threads (`--pipeline`)
+	static unsigned lex_threads; // Threads scanning a whole file (`--lex-threads <n>`, 0 for one per core)
+	static bool use_cache; // Reuse the programs compiled by previous runs (`--no-cache` disables it)
+	static bool benchmark_lexer; // Measure the throughput of the lexer instead of running (`--bench-lexer`)
+	static bool benchmark_analyzer; // Same for the semantic analyzer (`--bench-analyzer`)
 };
 
 extern std::string_view file_name;
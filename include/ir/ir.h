@@ -0,0 +1,116 @@
+#ifndef IR_H
+#define IR_H
+
+#include <bit>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "chunk.h"
+#include "mathobj.h"
+#include "operator.h"
+
+struct ASTNode;
+
+// Identifier of an SSA value (every value is defined by exactly one instruction)
+using IRValue = uint32_t;
+constexpr IRValue IR_NO_VALUE = UINT32_MAX;
+
+// Value of a constant, which constants are deduplicated on (reals compare by their bits,
+// so `1.0` and `1.00` are a single constant)
+struct ConstantKey
+{
+	MOT type = MOT::MO_NONE;
+	uint64_t bits = 0;
+
+	static ConstantKey of(long long value) { return { MOT::MO_INTEGER, (uint64_t)value }; }
+	static ConstantKey of(double value) { return { MOT::MO_REAL, std::bit_cast<uint64_t>(value) }; }
+
+	bool operator==(const ConstantKey & other) const = default;
+};
+
+struct ConstantKeyHash
+{
+	size_t operator()(const ConstantKey & key) const
+	{ return std::hash<uint64_t>()(key.bits) ^ (size_t)key.type; }
+};
+
+enum class IROpCode
+{
+	I_CONST,			// %v = const <constant>
+	I_LOAD_VAR,			// %v = load_var <variable>
+	I_VAR_REF,			// %v = var_ref <variable> (target of an assignment)
+	I_ASSIGN,			// %v = assign %ref, %value
+	I_SET_VAR,			// set_var <variable>, %value
+	I_SET_PARAM,		// set_param <variable> (pops an argument pushed by the caller)
+	I_UNARY,			// %v = <operator> %operand
+	I_BINARY,			// %v = <operator> %lhs, %rhs
+	I_CALL,				// %v = call <function>(%arg, ...)
+
+	I_ENTER_BLOCK,
+	I_LEAVE_BLOCK,
+
+	I_RETURN,
+	I_RETURN_VALUE,		// return_value %value
+	I_LEAVE_FUNCTION,
+};
+
+struct IRInstruction
+{
+	IRInstruction(IROpCode op, MathObjType type = MathObjType(MOT::MO_NONE), const ASTNode * node = nullptr) :
+		op(op),
+		type(type),
+		node(node)
+	{}
+	IRInstruction(IROpCode op, const ASTNode * node) :
+		IRInstruction(op, MathObjType(MOT::MO_NONE), node)
+	{}
+
+	IROpCode op;
+	IRValue result = IR_NO_VALUE;
+	MathObjType type;
+	std::vector<IRValue> operands;
+
+	uint8_t index = 0; // Variable or function index
+	std::shared_ptr<MathObj> constant;
+	ConstantKey constant_key; // Key used to deduplicate constants
+	std::shared_ptr<const OperatorFunction> op_func;
+	std::string op_name;
+
+	const ASTNode * node; // Source node (for error reporting)
+
+	bool has_result(void) const;
+	bool has_side_effects(void) const;
+	// The instruction can fail when the program runs, so it is kept even if its result is unused
+	bool can_trap(void) const;
+	// The value can be recomputed at any use instead of being kept alive
+	bool is_rematerializable(void) const;
+	bool is_terminator(void) const;
+};
+
+// A straight-line sequence of instructions that is lowered into a single chunk
+// (the language has no branches, so a function body is a single basic block)
+struct IRFunction
+{
+	IRFunction(std::string_view name, std::shared_ptr<Chunk> chunk) :
+		name(name),
+		chunk(chunk)
+	{}
+
+	std::string name;
+	std::shared_ptr<Chunk> chunk;
+	std::vector<IRInstruction> instructions;
+	IRValue next_value = 0;
+
+	IRValue append(IRInstruction instruction);
+
+	std::vector<size_t> use_counts(void) const;
+	// Index of the instruction defining each value (`SIZE_MAX` if the value is no longer defined)
+	std::vector<size_t> definitions(void) const;
+	void replace_all_uses(IRValue from, IRValue to);
+};
+
+ConstantKey constant_key(const std::shared_ptr<MathObj> & constant);
+
+#endif // IR_H
\ No newline at end of file
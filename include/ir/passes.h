@@ -0,0 +1,52 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "passmanager.h"
+
+// Evaluates pure builtin operators whose operands are all constants
+class ConstantFolding : public Pass
+{
+public:
+	const char * name(void) const override { return "constant-folding"; }
+	bool run(IRFunction & function) override;
+};
+
+// Replaces `^` by a constant exponent with cheaper operators:
+// `x ^ 1` by `x`, `x ^ n` by a chain of multiplications for a small integer n (only `x * x` for a real x,
+// as longer chains round differently from `^`) and `x ^ 0.5` by `sqrt x`
+class StrengthReduction : public Pass
+{
+	const OperatorTable & operator_table;
+
+public:
+	// Largest integer exponent expanded into multiplications (of an integer base, and of a real one)
+	static constexpr long long MAX_EXPONENT = 8;
+	static constexpr long long MAX_REAL_EXPONENT = 2;
+
+	StrengthReduction(const OperatorTable & operator_table) :
+		operator_table(operator_table)
+	{}
+
+	const char * name(void) const override { return "strength-reduction"; }
+	bool run(IRFunction & function) override;
+};
+
+// Computes structurally identical pure expressions only once (global value numbering).
+// Two variable loads are equivalent if the variable is not assigned and no function is
+// called between them
+class CommonSubexpressionElimination : public Pass
+{
+public:
+	const char * name(void) const override { return "common-subexpression-elimination"; }
+	bool run(IRFunction & function) override;
+};
+
+// Removes unused pure values and the instructions following a return
+class DeadCodeElimination : public Pass
+{
+public:
+	const char * name(void) const override { return "dead-code-elimination"; }
+	bool run(IRFunction & function) override;
+};
+
+#endif // PASSES_H
\ No newline at end of file
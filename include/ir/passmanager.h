@@ -0,0 +1,35 @@
+#ifndef PASSMANAGER_H
+#define PASSMANAGER_H
+
+#include <memory>
+#include <vector>
+
+#include "ir.h"
+
+// An optimization pass over a single IR function
+class Pass
+{
+public:
+	virtual ~Pass() = default;
+
+	virtual const char * name(void) const = 0;
+	// Returns true if the function was modified
+	virtual bool run(IRFunction & function) = 0;
+};
+
+class PassManager
+{
+	std::vector<std::unique_ptr<Pass>> passes;
+
+public:
+	// Maximum number of times the whole pipeline is repeated while passes keep making changes
+	static constexpr int MAX_ITERATIONS = 4;
+
+	void add_pass(std::unique_ptr<Pass> pass);
+	void run(IRFunction & function);
+
+	// Build the pipeline for an optimization level (`-O0`, `-O1` or `-O2`)
+	static PassManager for_level(int level, const OperatorTable & operator_table);
+};
+
+#endif // PASSMANAGER_H
\ No newline at end of file
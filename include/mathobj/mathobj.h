@@ -42,12 +42,12 @@ struct  MathObj
 	{ return static_cast<T *>(this); }
 };
 
-inline bool can_convert(MathObjType & from, MathObjType & to)
+inline bool can_convert(const MathObjType & from, const MathObjType & to)
 {
 	return from.type == to.type || to.type == 2 * from.type;
 }
 
-inline int calculate_specificity(MathObjType & type, MathObjType & argt)
+inline int calculate_specificity(const MathObjType & type, const MathObjType & argt)
 {
 	int specificity = 0;
 	// Calculate specificity based on type and constness
@@ -64,7 +64,7 @@ inline int calculate_specificity(MathObjType & type, MathObjType & argt)
 	return specificity;
 }
 
-inline int calculate_specificity(MathObjType & left, MathObjType & right, MathObjType & argt_l, MathObjType & argt_r)
+inline int calculate_specificity(const MathObjType & left, const MathObjType & right, const MathObjType & argt_l, const MathObjType & argt_r)
 {
 	int specificity = 0;
 	
@@ -85,8 +85,7 @@ public:
 		_value_(value)
 	{}
 
-	std::string to_string(void) const override
-	{ return std::to_string(_value_); }
+	std::string to_string(void) const override;
 
 	double value(void) const
 	{ return _value_; }
@@ -94,15 +93,20 @@ public:
 
 struct Integer : public Real
 {
-	Integer(int value) :
-		Real(value, MOT::MO_INTEGER)
+protected:
+	// Exact value (`_value_` holds it as a real number for mixed operations)
+	long long _int_value_;
+
+public:
+	Integer(long long value) :
+		Real(value, MOT::MO_INTEGER),
+		_int_value_(value)
 	{}
 
-	std::string to_string(void) const override
-	{ return std::to_string((int)_value_); }
+	std::string to_string(void) const override;
 
-	int value(void) const
-	{ return _value_; }
+	long long value(void) const
+	{ return _int_value_; }
 };
 
 struct None : public MathObj
@@ -138,9 +142,14 @@ struct Variable : public MathObj
 	{ return _value_type_; }
 };
 
-extern std::unordered_map<MOT, std::string> mathobjtype_string;
-
 std::string mathobjtype_to_string(MOT type);
+
+// Buffer size that fits any formatted number
+constexpr size_t NUMBER_CHARS = 32;
+// Shortest text that reads back as the same number (a real always has a decimal point or
+// an exponent). Both write at `first` and return the end of the text
+char * format_integer(char * first, long long value);
+char * format_real(char * first, double value);
 std::shared_ptr<MathObj> get_value(std::shared_ptr<MathObj> & obj);
 
 #endif // MATHOBJ_H
\ No newline at end of file
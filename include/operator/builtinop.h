@@ -4,6 +4,10 @@
 #include "mathobj.h"
 #include "operator.h"
 
+// Exact integer power, wrapping around on overflow (throws if the exponent is negative,
+// unless the base is 1 or -1)
+long long integer_power(long long base, long long exponent);
+
 // Binary operators
 extern BuiltinOpFunc ml__add__real_real;
 extern BuiltinOpFunc ml__subtract__real_real;
@@ -14,6 +18,7 @@ extern BuiltinOpFunc ml__assign__real_real;
 
 // Unary operators
 extern BuiltinOpFunc ml__negate__real;
+extern BuiltinOpFunc ml__sqrt__real;
 extern BuiltinOpFunc ml__print__real;
 extern BuiltinOpFunc ml__print__none;
 
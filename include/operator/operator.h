@@ -1,11 +1,13 @@
 #ifndef OPERATOR_H
 #define OPERATOR_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #include "token.h"
 #include "mathobj.h"
@@ -44,17 +46,20 @@ struct Operator
 	Operator(
 		std::string name,
 		Fixity fixity,
-		Precedence precedence
+		Precedence precedence,
+		uint8_t id
 	) :
 		name(name),
 		fixity(fixity),
-		precedence(precedence)
+		precedence(precedence),
+		id(id)
 	{}
 	virtual ~Operator() = default;
 
 	std::string name;
 	Fixity fixity;
 	Precedence precedence;
+	uint8_t id; // Row of the operator in the dispatch tables of its table
 
 	// for debugging
 	std::string_view get_name(void) const
@@ -63,13 +68,16 @@ struct Operator
 typedef Operator::OperatorType OperatorType;
 
 // Implementation of a builtin operator.
-struct OperatorFunction
+// Implementations are shared: the AST only keeps plain pointers to them
+struct OperatorFunction : public std::enable_shared_from_this<OperatorFunction>
 {
 	OperatorFunction(
 		OperatorType type,
 		BuiltinOpFunc implementation,
 		std::pair<MathObjType, MathObjType> arg_types,
 		MathObjType return_type,
+		bool is_pure = true,
+		bool can_trap = false,
 		// Reverse order of arguments because unary operators only have one argument (the right one)
 		bool rhs_is_const = true,
 		bool lhs_is_const = true
@@ -77,15 +85,35 @@ struct OperatorFunction
 		type(type),
 		implementation(implementation),
 		arg_types(arg_types),
-		return_type(return_type)
+		return_type(return_type),
+		is_pure(is_pure),
+		can_trap(can_trap)
 	{}
 
 	OperatorType type;
 	BuiltinOpFunc implementation;
 	std::pair<MathObjType, MathObjType> arg_types;
 	MathObjType return_type;
+	bool is_pure; // The result only depends on the arguments and there are no side effects
+	bool can_trap; // Can fail when the program runs (e.g. an integer division by zero)
 };
 
+// Implementation of an operator chosen for operands of given types
+struct OperatorDispatch
+{
+	enum class Status
+	{
+		D_UNDEFINED, // The operator has no implementation
+		D_MATCH,
+		D_NO_MATCH,
+		D_AMBIGUOUS
+	};
+
+	Status status = Status::D_UNDEFINED;
+	const OperatorFunction * function = nullptr; // With D_MATCH
+};
+typedef OperatorDispatch::Status DispatchStatus;
+
 // Table of operators
 class OperatorTable
 {
@@ -94,18 +122,43 @@ class OperatorTable
 	OpImplementations binary_implemetations; // Binary operator implementations
 	OpImplementations unary_implemetations; // Unary operator implementations
 
+	// Resolution of every operator for every combination of operand types (type and constness),
+	// in rows of TYPE_SLOTS^2 (binary) or TYPE_SLOTS (unary) entries indexed by operator id.
+	// The row of an operator is rebuilt when one of its implementations is registered
+	static constexpr size_t TYPE_SLOTS = (MOT::MO_REAL + 2) * 2; // From MO_NONE to MO_REAL
+	std::unordered_map<std::string, uint8_t> operator_ids;
+	std::vector<OperatorDispatch> binary_dispatch;
+	std::vector<OperatorDispatch> unary_dispatch;
+
+	uint8_t operator_id(const std::string & name);
+	void build_binary_dispatch(const std::string & name);
+	void build_unary_dispatch(const std::string & name);
+
+	static size_t type_slot(const MathObjType & type)
+	{ return (size_t)(type.type + 1) * 2 + (type.is_const ? 1 : 0); }
+	static MathObjType slot_type(size_t slot)
+	{ return MathObjType((MOT)((int)slot / 2 - 1), slot % 2 == 1); }
+
 public:
 	friend class Compiler; // Compiler needs access to the operator table
 	
 	void register_builtin_operators(void);
 	void register_operator(std::string name, Fixity fixity, Precedence precedence);
-	void register_unary_implementation(std::string name, BuiltinOpFunc & implementation, MathObjType arg_type, MathObjType ret_type);
-	void register_binary_implementation(std::string name, BuiltinOpFunc & implementation, std::pair<MathObjType, MathObjType> arg_types, MathObjType ret_type);
+	void register_unary_implementation(std::string name, BuiltinOpFunc & implementation, MathObjType arg_type, MathObjType ret_type, bool is_pure = true, bool can_trap = false);
+	void register_binary_implementation(std::string name, BuiltinOpFunc & implementation, std::pair<MathObjType, MathObjType> arg_types, MathObjType ret_type, bool is_pure = true, bool can_trap = false);
 
 	// Find an operator by name
 	std::shared_ptr<const Operator> find(std::string_view op_name) const;
 	// Find an operator implementation by name
 	std::pair<OpImplementations::const_iterator, OpImplementations::const_iterator> get_implementations(std::string_view op_name, bool unary = false) const;
+	// Most specific implementation for operands of these types (a lookup in the dispatch tables)
+	const OperatorDispatch & resolve_binary(const Operator & op, const MathObjType & left, const MathObjType & right) const
+	{ return binary_dispatch[(op.id * TYPE_SLOTS + type_slot(left)) * TYPE_SLOTS + type_slot(right)]; }
+	// First implementation (in the order of the table) which the operand can be converted to
+	const OperatorDispatch & resolve_unary(const Operator & op, const MathObjType & operand) const
+	{ return unary_dispatch[op.id * TYPE_SLOTS + type_slot(operand)]; }
+	// Find the implementation of an operator with exactly these argument types (ignoring constness)
+	std::shared_ptr<const OperatorFunction> find_implementation(std::string_view op_name, std::pair<MathObjType, MathObjType> arg_types, bool unary = false) const;
 };
 
 #endif // OPERATOR_H
\ No newline at end of file
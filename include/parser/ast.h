@@ -1,12 +1,13 @@
 #ifndef AST_H
 #define AST_H
 
-#include <memory>
+#include <cstdint>
+#include <span>
 #include <string_view>
-#include <variant>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
 
+#include "arena.h"
 #include "operator.h"
 #include "function.h"
 
@@ -46,161 +47,184 @@ enum class NodeType
 	N_TYPE
 };
 
+// Nodes live in the arena of their AST and refer to each other by index
+using NodeIndex = Arena::Index;
+constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+// Child nodes stored contiguously in the arena
+struct NodeList
+{
+	NodeIndex first = NO_NODE;
+	uint32_t size = 0;
+};
+
 // <statement> ::= <expression-statement> | <block> | <variable-declaration>
 struct AST
 {
-	std::vector<std::unique_ptr<ASTNode>> statements;
+	std::vector<NodeIndex> statements;
+
+	// Allocate a node (nodes never move, so the pointer stays valid)
+	template <typename T, typename... Args>
+	std::pair<NodeIndex, T *> make(Args &&... args)
+	{
+		NodeIndex index = arena.make<T>(std::forward<Args>(args)...);
+		return { index, &arena.get<T>(index) };
+	}
+	NodeList make_list(std::span<const NodeIndex> nodes);
+
+	ASTNode & node(NodeIndex index) { return arena.get<ASTNode>(index); }
+	const ASTNode & node(NodeIndex index) const { return arena.get<ASTNode>(index); }
+
+	// The node at `index` must have the type of T
+	template <typename T>
+	T & get(NodeIndex index) { return arena.get<T>(index); }
+	template <typename T>
+	const T & get(NodeIndex index) const { return arena.get<T>(index); }
+
+	std::span<const NodeIndex> list(NodeList list) const;
 
 	void print(void) const;
+	void print(NodeIndex index, int depth) const;
+
+private:
+	Arena arena; // Every node and list (the whole tree is freed with it)
 };
 
+// Nodes are plain data: they are never destroyed one by one, and the analyzer
+// only stores non-owning pointers in them
 struct ASTNode
 {
-	size_t line, column;
-	size_t start_position, end_position;
+	uint32_t location; // Offset shown as the position of the node in errors
+	uint32_t start_position, end_position;
 
 	const NodeType n_type;
 	ASTNode(NodeType n_type) : n_type(n_type) {}
-	virtual ~ASTNode() = default;
-	virtual void print(int depth) const = 0;
 };
 
 // <block> ::= "{" { <statement> } "}"
 struct BlockNode : public ASTNode
 {
-	std::vector<std::unique_ptr<ASTNode>> statements;
+	NodeList statements;
 	uint8_t relative_index;
 
 	BlockNode(void) : ASTNode(NodeType::N_BLOCK) {}
-	virtual void print(int depth) const override;
 };
 
 // <return> ::= "return"
 struct ReturnNode : public ASTNode
 {
 	ReturnNode(void) : ASTNode(NodeType::N_RETURN) {}
-	virtual void print(int depth) const override;
 };
 
 // <return-statement> ::= ":->" <expression>
 struct ReturnStatementNode : public ASTNode
 {
-	std::unique_ptr<ASTNode> value;
+	NodeIndex value = NO_NODE;
 
 	ReturnStatementNode(void) : ASTNode(NodeType::N_RETURN_STMT) {}
-	virtual void print(int depth) const override;
 };
 
 // <function-declaration> ::= "define" <identifier> "(" [ <parameter> { "," <parameter> } ] ")" [ "->" <type> ] <block>
 struct FunctionDeclarationNode : public ASTNode
 {
-	std::unique_ptr<IdentifierNode> name;
-	std::vector<std::unique_ptr<ParameterNode>> parameters;
-	std::unique_ptr<TypeNode> return_type;
-	std::unique_ptr<BlockNode> body;
-	std::shared_ptr<CustomFunction> function;
+	NodeIndex name = NO_NODE; // IdentifierNode
+	NodeList parameters; // ParameterNode
+	NodeIndex return_type = NO_NODE; // TypeNode
+	NodeIndex body = NO_NODE; // BlockNode
+	CustomFunction * function = nullptr; // Owned by the function table of the scope
 
 	FunctionDeclarationNode(void) : ASTNode(NodeType::N_FUNC_DECL) {}
-	virtual void print(int depth) const override;
 };
 
 // <function-call> ::= <identifier> "(" [ <expression> { "," <expression> } ] ")"
 struct FunctionCallNode : public ASTNode
 {
-	std::unique_ptr<IdentifierNode> name;
-	std::vector<std::unique_ptr<ASTNode>> arguments;
-	std::shared_ptr<Function> function;
+	NodeIndex name = NO_NODE; // IdentifierNode
+	NodeList arguments;
+	Function * function = nullptr; // Owned by the function table of the scope
 
 	FunctionCallNode(void) : ASTNode(NodeType::N_FUNC_CALL) {}
-	virtual void print(int depth) const override;
 };
 
 // <parameter> ::= <identifier> ":" <type> [ "=" <expression> ]
 struct ParameterNode : public ASTNode
 {
-	std::unique_ptr<IdentifierNode> name;
-	std::unique_ptr<TypeNode> type;
-	std::unique_ptr<ASTNode> default_value;
+	NodeIndex name = NO_NODE; // IdentifierNode
+	NodeIndex type = NO_NODE; // TypeNode
+	NodeIndex default_value = NO_NODE;
 
 	ParameterNode(void) : ASTNode(NodeType::N_PARAMETER) {}
-	virtual void print(int depth) const override;
 };
 
 // <variable-declaration> ::= "let" <type> <identifier> [ ":=" ( <expression> | <node> ) ]
 struct VariableDeclarationNode : public ASTNode
 {
-	std::unique_ptr<TypeNode> type;
-	std::unique_ptr<IdentifierNode> name;
-	std::unique_ptr<ASTNode> value;
+	NodeIndex type = NO_NODE; // TypeNode
+	NodeIndex name = NO_NODE; // IdentifierNode
+	NodeIndex value = NO_NODE;
 
 	VariableDeclarationNode(void) : ASTNode(NodeType::N_VAR_DECL) {}
-	virtual void print(int depth) const override;
 };
 
 // <expression-statement> ::= { <operand> | <expression> }
 struct ExpressionStatementNode : public ASTNode
 {
-	std::vector<std::unique_ptr<ASTNode>> expressions;
+	NodeList expressions;
 
 	ExpressionStatementNode(void) : ASTNode(NodeType::N_EXPR_STMT) {}
-	virtual void print(int depth) const override;
 };
 
 // <expression> ::= ( <operand> | <expression> ) <operator> ( <operand> | <expression> )
 struct ExpressionNode : public ASTNode
 {
-	std::unique_ptr<ASTNode> left;
-	std::unique_ptr<OperatorNode> op;
-	std::unique_ptr<ASTNode> right;
-
-	ExpressionNode(void) : ASTNode(NodeType::N_EXPR) {}
-	ExpressionNode(
-		std::unique_ptr<ASTNode> left,
-		std::unique_ptr<OperatorNode> op,
-		std::unique_ptr<ASTNode> right
-	) : left(move(left)), op(move(op)), right(move(right)), ASTNode(NodeType::N_EXPR) {}
+	NodeIndex left;
+	NodeIndex op; // OperatorNode
+	NodeIndex right;
 
-	virtual void print(int depth) const override;
+	ExpressionNode(NodeIndex left, NodeIndex op, NodeIndex right) :
+		left(left), op(op), right(right), ASTNode(NodeType::N_EXPR) {}
 };
 
 // <operand> ::= <operator> <primary>
 // <primary> ::= <literal> | <identifier> | ( <operand> | <expression> )
 struct OperandNode : public ASTNode
 {
-	std::unique_ptr<OperatorNode> op;
-	std::unique_ptr<ASTNode> primary;
+	NodeIndex op = NO_NODE; // OperatorNode
+	NodeIndex primary = NO_NODE;
 
 	OperandNode(void) : ASTNode(NodeType::N_OPERAND) {}
-	virtual void print(int depth) const override;
 };
 
 struct LiteralNode : public ASTNode
 {
 	MathObjType type;
-	std::string_view value;
+	std::string_view value; // Lexeme
+	union // Converted by the parser
+	{
+		long long integer;
+		double real;
+	};
 
 	LiteralNode(void) : ASTNode(NodeType::N_LITERAL) {}
-	virtual void print(int depth) const override;
 };
 
 struct IdentifierNode : public ASTNode
 {
 	std::string_view name;
+	SymbolId symbol; // Interned by the lexer
 
-	IdentifierNode(std::string_view name) : name(name), ASTNode(NodeType::N_IDENTIFIER) {}
-	virtual void print(int depth) const override;
+	IdentifierNode(std::string_view name, SymbolId symbol) : name(name), symbol(symbol), ASTNode(NodeType::N_IDENTIFIER) {}
 };
 
 struct OperatorNode : public ASTNode
 {
-	std::shared_ptr<const Operator> op_info;
-	std::shared_ptr<const OperatorFunction> op_func;
+	const Operator * op_info; // Owned by the operator table
+	const OperatorFunction * op_func = nullptr; // Owned by the operator table
 
-	OperatorNode(std::shared_ptr<const Operator> op_info) :
+	OperatorNode(const Operator * op_info) :
 		op_info(op_info),
 		ASTNode(NodeType::N_OPERATOR)
 	{}
-	virtual void print(int depth) const override;
 };
 
 struct TypeNode : public ASTNode
@@ -209,7 +233,6 @@ struct TypeNode : public ASTNode
 
 	TypeNode(void) : ASTNode(NodeType::N_TYPE) {}
 	TypeNode(MathObjType type) : type(type), ASTNode(NodeType::N_TYPE) {}
-	virtual void print(int depth) const override;
 };
 
 #endif // AST_H
\ No newline at end of file
@@ -11,35 +11,48 @@ class Lexer
 {
 private:
 	std::string_view source; // source code
-	size_t pos; // current position inside `source`
-	size_t line, column;
+	std::shared_ptr<SymbolTable> symbols; // Names of the identifiers
+	size_t pos; // current position inside `source` (see lineindex.h for lines and columns)
 
 	void skip_whites(void);
 	void skip_comment(void);
 
 	char advance(void);
 	char advance(int jump);
+	// Advance over the run of characters measured by `scan` (see scan.h), returns its length
+	size_t advance_over(size_t (*scan)(const char * begin, const char * end));
 	char peek(void);
 	char peek(int lookahead);
 	char peek_next(void);
 
-	std::unique_ptr<Token> make_tk(TokenType type, std::string_view lexeme, size_t start_column, size_t start_pos);
-	std::unique_ptr<Token> make_number_tk(void); // Integer/real token
-	std::unique_ptr<Token> make_word_tk(void); // Identifier/keyword token
-	std::unique_ptr<Token> make_operator_tk(void); // Operator token
+	Token make_tk(TokenType type, std::string_view lexeme, size_t start_pos);
+	Token make_number_tk(void); // Integer/real token
+	Token make_word_tk(void); // Identifier/keyword token
+	Token make_operator_tk(void); // Operator token
 
 	bool at_end(void);
 
 public:
-	Lexer(std::string_view source) :
+	// Scanning starts at `start`
+	Lexer(std::string_view source, std::shared_ptr<SymbolTable> symbols, size_t start = 0) :
 		source(source),
-		pos(0),
-		line(1),
-		column(1)
+		symbols(std::move(symbols)),
+		pos(start)
 	{}
 	std::string_view get_source(void) { return source; };
-
-	std::unique_ptr<Token> scan_tk(void);
+	size_t get_position(void) const { return pos; }
+
+	Token scan_tk(void);
+	// Scan the whole source (the last token is always EOF)
+	std::vector<Token> tokenize(void);
+	// Same, with the source split into segments of lines scanned by up to `threads` threads.
+	// The tokens (and the ids of the names) are the same as with `tokenize()`
+	std::vector<Token> tokenize_parallel(unsigned threads);
+	// Sources are not split into segments smaller than this
+	static constexpr size_t PARALLEL_SEGMENT_BYTES = 1 << 20;
+	// Scan the next top-level statements, until at least `min_tokens` tokens were scanned or
+	// the source ends (the last token is always EOF, and only EOF is left at the end of the source)
+	std::vector<Token> tokenize_statements(size_t min_tokens);
 };
 
 #endif // LEXER_H
\ No newline at end of file
@@ -3,51 +3,84 @@
 
 #include <memory>
 #include <string_view>
+#include <vector>
 
 #include "ast.h"
 #include "token.h"
 #include "operator.h"
 #include "lexer.h"
+#include "lineindex.h"
 
 class Parser
 {
 private:
-	std::unique_ptr<Lexer> lexer;
+	std::vector<Token> tokens; // Whole token stream (ends with EOF)
+	size_t tk_index = 0;
 	AST ast;
 
-	std::unique_ptr<Token> curr_tk;
-	std::unique_ptr<Token> next_tk;
+	// Point into `tokens`
+	const Token * curr_tk = nullptr;
+	const Token * next_tk = nullptr;
 
 	bool panic_mode = false;
 
+	std::unique_ptr<LineIndex> token_lines; // Only built to print the tokens (-l)
+
 	bool consume_tk(void);
 	void expect_tk(TokenType type, std::string message);
 	void register_syntax_error(std::string message);
 	void synchronize(void);
 
-	std::unique_ptr<ASTNode>					statement_n(void)						;
-	std::unique_ptr<BlockNode>					block_n(void)							;
-	std::unique_ptr<ReturnNode>					return_n(void)							;
-	std::unique_ptr<ReturnStatementNode>		return_statement_n(void)				;
-	std::unique_ptr<FunctionDeclarationNode>	function_declaration_n(void)			;
-	std::unique_ptr<FunctionCallNode>			function_call_n(void)					;
-	std::unique_ptr<ParameterNode>				parameter_n(void)						;
-	std::unique_ptr<VariableDeclarationNode>	variable_declaration_n(void)			;
-	std::unique_ptr<ExpressionStatementNode>	expression_statement_n(void)			;
-	std::unique_ptr<ASTNode>					expression_n(Precedence min_precedence)	;
-	std::unique_ptr<ASTNode>					operand_n(void)							;
-	std::unique_ptr<ASTNode>					primary_n(void)							;
-	std::unique_ptr<LiteralNode>				literal_n(void)							;
-	std::unique_ptr<IdentifierNode>				identifier_n(void)						;
-	std::unique_ptr<OperatorNode>				operator_n(bool unary = false)			;
-	std::unique_ptr<TypeNode>					type_n(void)							;
+	// Children of the lists being parsed (copied to the AST when a list is complete)
+	std::vector<NodeIndex> list_stack;
+	NodeList make_list(size_t list_start);
+
+	// Expression, operand or parenthesized expression being parsed by `expression_n()`
+	struct ExpressionFrame
+	{
+		enum Kind
+		{
+			F_EXPRESSION,
+			F_OPERAND,
+			F_PARENTHESES
+		} kind;
+
+		Precedence min_precedence = P_MIN; // F_EXPRESSION: lowest precedence of its operators
+		NodeIndex left = NO_NODE; // F_EXPRESSION: left operand (what was parsed so far)
+		NodeIndex op = NO_NODE; // F_EXPRESSION: operator waiting for its right operand, F_OPERAND: unary operator
+		uint32_t start_position = 0; // F_OPERAND and F_PARENTHESES: first token
+
+		static ExpressionFrame expression(Precedence min_precedence)
+		{ return { F_EXPRESSION, min_precedence }; }
+		// Operand or parentheses
+		static ExpressionFrame starting_at(Kind kind, const Token & first)
+		{ return { kind, P_MIN, NO_NODE, NO_NODE, (uint32_t)first.position() }; }
+	};
+	std::vector<ExpressionFrame> expression_stack;
+
+	NodeIndex	statement_n(void)						;
+	NodeIndex	block_n(void)							;
+	NodeIndex	return_n(void)							;
+	NodeIndex	return_statement_n(void)				;
+	NodeIndex	function_declaration_n(void)			;
+	NodeIndex	function_call_n(void)					;
+	NodeIndex	parameter_n(void)						;
+	NodeIndex	variable_declaration_n(void)			;
+	NodeIndex	expression_statement_n(void)			;
+	NodeIndex	expression_n(Precedence min_precedence)	;
+	NodeIndex	literal_n(void)							;
+	NodeIndex	identifier_n(void)						;
+	NodeIndex	operator_n(bool unary = false)			;
+	NodeIndex	type_n(void)							;
 	
 public:
-	std::unique_ptr<OperatorTable> operators;
+	std::shared_ptr<OperatorTable> operators;
 
-	Parser(Lexer & lexer);
+	Parser(Lexer & lexer, std::shared_ptr<OperatorTable> operators);
+	// Tokens scanned from `source` (they end with EOF)
+	Parser(std::vector<Token> tokens, std::string_view source, std::shared_ptr<OperatorTable> operators);
 
-	const AST & get_ast(void) const { return ast; }
+	AST & get_ast(void) { return ast; }
 	void parse_source(void);
 };
 
@@ -0,0 +1,19 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+/* Classification of runs of source characters, 32 bytes at a time with AVX2
+   or 16 bytes at a time with SSE2 (scalar otherwise).
+   Each function returns the length of the longest prefix of [begin, end) made
+   of characters of its class.
+*/
+size_t scan_blanks(const char * begin, const char * end); // ' ', '\t' and '\r'
+size_t scan_word_chars(const char * begin, const char * end); // Letters, digits and '_'
+size_t scan_number_chars(const char * begin, const char * end); // Digits and '.'
+size_t scan_line(const char * begin, const char * end); // Anything but '\n' and '\0'
+
+// "AVX2", "SSE2" or "scalar"
+const char * scan_instruction_set(void);
+
+#endif // SCAN_H
\ No newline at end of file
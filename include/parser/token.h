@@ -2,6 +2,10 @@
 #define TOKEN_H
 
 #include <string_view>
+#include <type_traits>
+#include <cstdint>
+
+#include "symbol.h"
 
 struct Token
 {
@@ -52,45 +56,32 @@ struct Token
 		T_ERROR, T_EOF
 	};
 
-	Token(TokenType type, std::string_view lexeme, size_t line, size_t column, size_t position) :
+	Token(TokenType type, std::string_view lexeme, size_t position, SymbolId symbol = NO_SYMBOL) :
 		_type_(type),
-		_lexeme_(lexeme),
-		_line_(line),
-		_column_(column),
-		_pos_(position)
+		_pos_(position),
+		_symbol_(symbol),
+		_lexeme_(lexeme)
 	{}
 
-	TokenType type(void) { return _type_; }
-	std::string_view lexeme(void) { return _lexeme_; }
-	size_t line(void) { return _line_; }
-	size_t column(void) { return _column_; }
-	size_t position(void) { return _pos_; }
+	TokenType type(void) const { return _type_; }
+	std::string_view lexeme(void) const { return _lexeme_; }
+	size_t position(void) const { return _pos_; }
+	SymbolId symbol(void) const { return _symbol_; } // Interned name of an identifier
 
-	bool is_literal(void);
-	bool is_identifier(void);
-	bool is_operator(void);
-	bool is_eof(void);
+	bool is_literal(void) const;
+	bool is_identifier(void) const;
+	bool is_operator(void) const;
+	bool is_eof(void) const;
 
 private:
+	// Tokens are stored by value in a contiguous buffer, so they are kept small
 	TokenType _type_;
+	uint32_t _pos_; // Byte offset (see lineindex.h for the line and column)
+	SymbolId _symbol_;
 	std::string_view _lexeme_;
-	size_t _line_, _column_;
-	size_t _pos_;
 };
 typedef Token::TokenType TokenType;
-
-struct EOFToken : Token
-{
-	EOFToken(size_t line, size_t column, size_t position) :
-		Token (
-			TokenType::T_EOF,
-			"",
-			line,
-			column,
-			position
-		)
-	{}
-};
+static_assert(std::is_trivially_copyable_v<Token>);
 
 TokenType check_word_t_type(std::string_view lexeme);
 
@@ -0,0 +1,92 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for trivially destructible objects, which are addressed by 32-bit indices.
+// Objects are stored contiguously in large blocks and never move, and they are all released
+// at once with the arena (no destructor is run)
+class Arena
+{
+public:
+	using Index = uint32_t;
+
+	static constexpr size_t UNIT = 8; // Indices count units of 8 bytes (the alignment of every object)
+	static constexpr size_t BLOCK_UNITS = 8192; // 64 KiB blocks
+
+	template <typename T, typename... Args>
+	Index make(Args &&... args)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+		static_assert(alignof(T) <= UNIT);
+
+		Index index = allocate(units_for(sizeof(T)));
+		new (address(index)) T(std::forward<Args>(args)...);
+		return index;
+	}
+
+	// Copy of `size` objects (returns the index of the first one)
+	template <typename T>
+	Index make_array(const T * values, size_t size)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		static_assert(alignof(T) <= UNIT);
+
+		Index index = allocate(units_for(sizeof(T) * size));
+		auto * destination = static_cast<T *>(address(index));
+		for (size_t i = 0; i < size; i++)
+			new (destination + i) T(values[i]);
+		return index;
+	}
+
+	template <typename T>
+	T & get(Index index) { return *std::launder(static_cast<T *>(address(index))); }
+	template <typename T>
+	const T & get(Index index) const { return *std::launder(static_cast<const T *>(address(index))); }
+
+	template <typename T>
+	const T * get_array(Index index) const { return std::launder(static_cast<const T *>(address(index))); }
+
+private:
+	struct alignas(UNIT) Unit { std::byte bytes[UNIT]; };
+
+	std::vector<std::unique_ptr<Unit[]>> blocks;
+	size_t used = BLOCK_UNITS; // Units used in the last block
+
+	static constexpr size_t units_for(size_t bytes)
+	{ return (bytes + UNIT - 1) / UNIT; }
+
+	Index allocate(size_t units)
+	{
+		// Larger objects get a block of their own, which spans as many indices as they need
+		if (units > BLOCK_UNITS)
+		{
+			Index index = blocks.size() * BLOCK_UNITS;
+			blocks.emplace_back(new Unit[units]);
+			blocks.resize(blocks.size() + (units - 1) / BLOCK_UNITS);
+			used = BLOCK_UNITS;
+			return index;
+		}
+
+		// An object is never split across blocks
+		if (used + units > BLOCK_UNITS)
+		{
+			blocks.emplace_back(new Unit[BLOCK_UNITS]);
+			used = 0;
+		}
+
+		Index index = (blocks.size() - 1) * BLOCK_UNITS + used;
+		used += units;
+		return index;
+	}
+
+	void * address(Index index) const
+	{ return blocks[index / BLOCK_UNITS].get() + index % BLOCK_UNITS; }
+};
+
+#endif // ARENA_H
\ No newline at end of file
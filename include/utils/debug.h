@@ -6,6 +6,6 @@
 
 #include "token.h"
 
-void d_print_token(std::unique_ptr<Token> & token);
+void d_print_token(const Token & token, size_t line);
 
 #endif // DEBUG_H
\ No newline at end of file
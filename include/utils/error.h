@@ -25,8 +25,6 @@ struct Error
 
 	ErrorType type(void) { return _type_; }
 	std::string message(void) { return _message_; }
-	size_t line(void) { return _line_; }
-	size_t column(void) { return _column_; }
 	size_t position(void) { return _pos_; }
 
 	virtual std::string get_additional_info(void) const = 0;
@@ -34,28 +32,24 @@ struct Error
 	{ return _len_; }
 
 protected:
-	Error(ErrorType type, std::string msg, size_t l, size_t c, size_t pos, size_t len) :
+	Error(ErrorType type, std::string msg, size_t pos, size_t len) :
 		_type_(type),
 		_message_(msg),
-		_line_(l),
-		_column_(c),
 		_pos_(pos),
 		_len_(len)
 	{}
 
 	ErrorType _type_;
 	std::string _message_;
-	size_t _line_; // Line number where the error occurred
-	size_t _column_; // Column number where the error occurred
-	size_t _pos_; // Index of the error
+	size_t _pos_; // Index of the error (its line and column are found when it is reported)
 	size_t _len_;
 };
 typedef Error::ErrorType ErrorType;
 
 struct LexicalError : Error
 {
-	LexicalError(std::string_view lexeme, std::string msg, size_t l, size_t c, size_t pos) :
-		Error(ErrorType::LEXICAL_ERR, msg, l, c, pos, lexeme.length()),
+	LexicalError(std::string_view lexeme, std::string msg, size_t pos) :
+		Error(ErrorType::LEXICAL_ERR, msg, pos, lexeme.length()),
 		lexeme(lexeme)
 	{}
 
@@ -68,8 +62,8 @@ private:
 
 struct SyntaxError : Error
 {
-	SyntaxError(std::string msg, size_t l, size_t c, size_t pos, size_t len) :
-		Error(ErrorType::SYNTAX_ERR, msg, l, c, pos, len)
+	SyntaxError(std::string msg, size_t pos, size_t len) :
+		Error(ErrorType::SYNTAX_ERR, msg, pos, len)
 	{}
 
 	std::string get_additional_info(void) const override
@@ -80,8 +74,8 @@ struct SemanticError : Error
 {
 	std::string additional_info;
 
-	SemanticError(std::string msg, std::string additional_info, size_t l, size_t c, size_t pos, size_t len) :
-		Error(ErrorType::SEMANTIC_ERR, msg, l, c, pos, len),
+	SemanticError(std::string msg, std::string additional_info, size_t pos, size_t len) :
+		Error(ErrorType::SEMANTIC_ERR, msg, pos, len),
 		additional_info(additional_info)
 	{}
 	
@@ -93,8 +87,8 @@ struct CompileError : Error
 {
 	std::string additional_info;
 
-	CompileError(std::string msg, std::string additional_info, size_t l, size_t c, size_t pos, size_t len) :
-		Error(ErrorType::COMPILE_ERR, msg, l, c, pos, len),
+	CompileError(std::string msg, std::string additional_info, size_t pos, size_t len) :
+		Error(ErrorType::COMPILE_ERR, msg, pos, len),
 		additional_info(additional_info)
 	{}
 	
@@ -106,12 +100,19 @@ class ErrorHandler
 {
 public:
 	static bool has_errors(void);
-	static void report_errors(std::string_view source);
+	// `source` starts at the beginning of line `first_line` of the file (positions are relative to it)
+	static void report_errors(std::string_view source, size_t first_line = 1);
+	static void discard_errors(void);
 
 	static void push_error(std::unique_ptr<Error> & err);
 
+	// Errors are kept per thread: those found on another thread (see `--pipeline`) are taken
+	// from it and pushed on the thread which reports them
+	static std::vector<std::unique_ptr<Error>> take_errors(void);
+	static void push_errors(std::vector<std::unique_ptr<Error>> errors);
+
 private:
-	static std::vector<std::unique_ptr<Error>> errors;
+	static thread_local std::vector<std::unique_ptr<Error>> errors;
 };
 
 #endif // ERROR_H
\ No newline at end of file
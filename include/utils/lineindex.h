@@ -0,0 +1,33 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Columns a tab counts for in the positions reported to the user
+constexpr size_t TAB_WIDTH = 4;
+
+// Offsets of the line starts of a source, built in one pass. Tokens and nodes only store
+// byte offsets, which are turned into a line and a column when they are shown
+class LineIndex
+{
+public:
+	struct Location
+	{
+		size_t line, column; // Both start at 1
+	};
+
+	explicit LineIndex(std::string_view source);
+
+	Location locate(size_t position) const;
+	// Text of a line (without its '\n')
+	std::string_view line_text(size_t line) const;
+
+private:
+	std::string_view source;
+	std::vector<uint32_t> line_starts; // line_starts[i] is the offset of line i + 1
+};
+
+#endif // LINEINDEX_H
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. The file is memory-mapped where the platform allows it,
+// so the lexer reads the pages directly instead of a copy
+class MappedFile
+{
+public:
+	// Throws std::ios_base::failure if the file cannot be opened or mapped
+	explicit MappedFile(const std::string & path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	std::string_view view(void) const { return { data, size }; }
+
+private:
+	const char * data = nullptr;
+	size_t size = 0;
+#if defined(_WIN32)
+	std::string buffer; // No mapping, the file is read into memory
+#endif
+};
+
+#endif // MAPPEDFILE_H
\ No newline at end of file
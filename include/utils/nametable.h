@@ -0,0 +1,22 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// Dense array of the names of the values of an enum, built at compile time from a list of
+// (value, name) pairs. `first` is the smallest value of the enum, and values without a name
+// get `fallback`
+template <typename E, size_t SIZE, size_t N>
+constexpr std::array<const char *, SIZE> make_name_table(const std::pair<E, const char *> (&names)[N], const char * fallback, int first = 0)
+{
+	std::array<const char *, SIZE> table {};
+	for (auto & name : table)
+		name = fallback;
+	for (auto & [value, name] : names)
+		table[(int)value - first] = name;
+	return table;
+}
+
+#endif // NAMETABLE_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Bounded queue between one producer thread and one consumer thread. It has no lock: each side
+// only writes its own counter, and a thread only sleeps (waiting on the counter of the other side)
+// when the queue is full or empty
+template <typename T>
+class SpscQueue
+{
+public:
+	// `capacity` must be a power of two
+	explicit SpscQueue(uint32_t capacity) : slots(capacity), mask(capacity - 1) {}
+
+	// Blocks while the queue is full
+	void push(T value)
+	{
+		uint32_t tail = this->tail.load(std::memory_order_relaxed);
+		uint32_t head;
+		while (tail - (head = this->head.load(std::memory_order_acquire)) == slots.size())
+			this->head.wait(head, std::memory_order_acquire);
+
+		slots[tail & mask] = std::move(value);
+		this->tail.store(tail + 1, std::memory_order_release);
+		this->tail.notify_one();
+	}
+
+	// Blocks while the queue is empty
+	T pop(void)
+	{
+		uint32_t head = this->head.load(std::memory_order_relaxed);
+		uint32_t tail;
+		while ((tail = this->tail.load(std::memory_order_acquire)) == head)
+			this->tail.wait(tail, std::memory_order_acquire);
+
+		T value = std::move(*slots[head & mask]);
+		slots[head & mask].reset();
+		this->head.store(head + 1, std::memory_order_release);
+		this->head.notify_one();
+		return value;
+	}
+
+private:
+	std::vector<std::optional<T>> slots;
+	uint32_t mask;
+
+	// Counts of the values pushed and popped (they wrap around), on separate cache lines
+	alignas(64) std::atomic<uint32_t> tail = 0; // Written by the producer
+	alignas(64) std::atomic<uint32_t> head = 0; // Written by the consumer
+};
+
+#endif // SPSCQUEUE_H
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "mathobj.h"
+
+// Dense identifier of an interned name or function signature
+using SymbolId = uint32_t;
+constexpr SymbolId NO_SYMBOL = UINT32_MAX;
+
+// Interned identifiers (by the lexer) and function signatures (by the semantic analyzer).
+// Tables of the scopes are keyed on the ids, so lookups compare integers. Names and signatures
+// are kept apart, so the lexer can run on another thread than the analyzer (see `--pipeline`)
+class SymbolTable
+{
+public:
+	SymbolId intern(std::string_view name);
+	// Name and parameter types of a function (the names of the parameters are not part of it).
+	// Signatures are numbered apart from names
+	SymbolId intern_signature(SymbolId name, std::span<const MOT> parameter_types);
+
+	std::string_view name(SymbolId symbol) const { return names[symbol]; }
+	size_t size(void) const { return names.size(); }
+
+private:
+	std::deque<std::string> names; // Never moved, the keys of `symbols` point into them
+	std::unordered_map<std::string_view, SymbolId> symbols;
+	std::unordered_map<std::string, SymbolId> signatures; // Keyed on the bytes of the ids and types
+	SymbolId signature_count = 0;
+};
+
+#endif // SYMBOL_H
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Directory of compiled programs (see image.h) shared by every run of the interpreter.
+// Entries are named after a hash of the source and of whatever else the bytecode depends on,
+// so a changed source or interpreter simply misses. Entries are written atomically (several
+// processes can share the directory) and the least recently used ones are evicted when the
+// directory grows over its capacity
+class ProgramCache
+{
+public:
+	static constexpr uintmax_t CAPACITY = 64 << 20; // Bytes
+
+	explicit ProgramCache(std::filesystem::path directory) : directory(std::move(directory)) {}
+
+	// $MATHLANG_CACHE_DIR, $XDG_CACHE_HOME/mathlang or ~/.cache/mathlang (empty if none is set)
+	static std::filesystem::path default_directory(void);
+
+	// `salt` holds what the bytecode depends on besides the source (version and options)
+	std::filesystem::path entry(std::string_view source, std::string_view salt) const;
+
+	// Marks an entry as just used
+	void touch(const std::filesystem::path & entry) const;
+	// The cache is best-effort: these fail silently
+	void store(const std::filesystem::path & entry, std::string_view image) const;
+	void remove(const std::filesystem::path & entry) const;
+
+private:
+	std::filesystem::path directory;
+
+	void evict(void) const;
+};
+
+#endif // CACHE_H
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "chunk.h"
+#include "scope.h"
+#include "session.h"
+
+#define IMAGE_EXTENSION ".mthlc"
+
+// Compiled program, written by `mathlang -c` and run without the front end. It holds the tables
+// of the session (constants, variables, functions and operators, at the indices the bytecode
+// uses), the bytecode of the main chunk and of every function, and the shape of the scopes
+// entered by OP_ENTER_BLOCK. The names declared in the global scope are kept too, so an image
+// can be loaded as the prelude of more source (see `--prelude`). An image can also be a snapshot
+// of the state a program left when it ran (the values of the variables and what it printed),
+// which is restored instead of run. The bytecode is not copied when the image is loaded
+constexpr uint16_t IMAGE_VERSION = 3;
+// Deepest nesting of blocks in a loaded image
+constexpr size_t MAX_IMAGE_SCOPE_DEPTH = 1024;
+
+// Every function must be compiled (see `Compiler::compile_pending_functions()`). With `printed`,
+// the image is a snapshot of the variables of the session, left by a run that printed it
+void write_image(std::ostream & out, const Session & session, const Chunk & main, const Scope & global_scope,
+	const std::string * printed = nullptr);
+
+// Fills an empty session and the global scope (its names are interned in the symbols of the
+// session), and returns the main chunk. The variables of a snapshot get their values back and
+// `printed` is set to its output. The chunks and `printed` point into `image`, which must
+// outlive them. The bytecode is verified before it can be run. Throws std::runtime_error if the
+// image is invalid or was written by another version
+std::shared_ptr<Chunk> load_image(std::string_view image, Session & session, const std::shared_ptr<Scope> & global_scope,
+	std::string_view & printed);
+
+#endif // IMAGE_H
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+// Standard output of the programs run by a VM. Writes are gathered in a large block, which
+// is written out when it is full, when a run ends and when the buffer is destroyed
+class OutputBuffer
+{
+public:
+	static constexpr size_t CAPACITY = 64 * 1024;
+
+	// Output of the VM that is running (where the builtin `print` writes)
+	static OutputBuffer * active;
+
+	explicit OutputBuffer(std::ostream & stream);
+	~OutputBuffer();
+
+	OutputBuffer(const OutputBuffer &) = delete;
+	OutputBuffer & operator=(const OutputBuffer &) = delete;
+
+	void write(std::string_view text);
+	void write_integer(long long value);
+	void write_real(double value);
+	void flush(void);
+
+private:
+	std::ostream & stream;
+	std::unique_ptr<char[]> buffer;
+	size_t size = 0;
+
+	// Makes room for `length` more bytes
+	void reserve(size_t length);
+};
+
+#endif // OUTPUT_H
\ No newline at end of file
@@ -2,13 +2,28 @@
 #define SCOPE_H
 
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "mathobj.h"
 #include "function.h"
-#include "util.h"
+#include "symbol.h"
+
+// Outcome of the overload resolution of a call
+struct OverloadResolution
+{
+	enum class Status
+	{
+		R_MATCH, R_NO_MATCH, R_AMBIGUOUS
+	};
+
+	Status status;
+	Function * function; // Most specific implementation (with R_MATCH)
+};
+typedef OverloadResolution::Status ResolutionStatus;
 
 struct Scope {
 	Scope() : parent(nullptr) {}
@@ -17,15 +32,35 @@ struct Scope {
 
 	std::shared_ptr<Scope> parent;
 	std::vector<std::shared_ptr<Scope>> children;
-	std::unordered_map<std::string_view, std::shared_ptr<Variable>> variables;
-	std::unordered_map<std::string, uint8_t> variable_indices;
+	// Keyed on interned names (see symbol.h)
+	std::unordered_map<SymbolId, std::shared_ptr<Variable>> variables;
+	std::unordered_map<SymbolId, uint8_t> variable_indices;
 	FunctionTable function_table;
-	std::unordered_map<std::string, uint8_t> function_indices;
+	std::unordered_map<SymbolId, uint8_t> function_indices; // Keyed on signatures
+
+	// Overload resolutions of the calls made in this scope, per function name
+	struct OverloadSet
+	{
+		size_t implementations = 0; // Visible implementations when the calls were resolved
+		uint64_t declarations = UINT64_MAX; // `FunctionTable::declarations` when they were counted
+		std::unordered_map<std::string, OverloadResolution> calls; // Keyed on the argument types
+	};
+	std::unordered_map<SymbolId, OverloadSet> overloads;
+	// The calls of `name`, cleared if implementations of it were declared since they were resolved
+	OverloadSet & overload_set(SymbolId name);
+
+	std::unordered_map<SymbolId, std::shared_ptr<Variable>>::iterator find_variable(SymbolId name, bool local_only = false);
+	std::optional<uint8_t> find_variable_index(SymbolId name);
+	// Implementations visible from this scope, innermost scopes first (and in order of declaration in each)
+	std::vector<Function *> get_function_implementations(SymbolId name);
+	size_t count_function_implementations(SymbolId name); // Counted once until a function is declared
+	Function * find_function(SymbolId signature);
+	std::optional<uint8_t> find_function_index(SymbolId signature);
 
-	std::unordered_map<std::string_view, std::shared_ptr<Variable>>::iterator find_variable(std::string_view name, bool local_only = false);
-	uint8_t find_variable_index(std::string name);
-	MultiRange<FuncImplementations::const_iterator> get_function_implementations(std::string_view name);
-	uint8_t find_function_index(std::string name);
+	// Resolves a call from the types of its arguments. Results are cached in the scope
+	// until an implementation of the same name is declared in it or in one of its parents
+	// (the scopes are only walked again after a function was declared somewhere)
+	const OverloadResolution & resolve_call(SymbolId name, std::span<const MathObjType> argument_types);
 };
 
 void push_scope(std::shared_ptr<Scope> & scope);
@@ -0,0 +1,74 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mathobj.h"
+#include "function.h"
+#include "operator.h"
+#include "symbol.h"
+#include "ir.h"
+
+// State the inputs run by a VM (a file, or the lines of the REPL) are compiled against.
+// It is kept from one input to the next, so the work done for an input only depends on its size
+struct Session
+{
+	Session(void) :
+		symbols(new SymbolTable),
+		operator_table(new OperatorTable),
+		constants(new std::vector<std::shared_ptr<MathObj>>()),
+		variables(new std::vector<std::shared_ptr<Variable>>()),
+		functions(new std::vector<std::shared_ptr<Function>>()),
+		operators(new std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>())
+	{
+		operator_table->register_builtin_operators();
+	}
+
+	std::shared_ptr<SymbolTable> symbols; // Keys of the tables of the scopes
+	std::shared_ptr<OperatorTable> operator_table; // Builtin operators are registered once
+
+	// Tables indexed by the bytecode (constants and operators are deduplicated across inputs)
+	std::shared_ptr<std::vector<std::shared_ptr<MathObj>>> constants;
+	std::unordered_map<ConstantKey, uint8_t, ConstantKeyHash> constant_indices; // Keyed on `IRInstruction::constant_key`
+	std::shared_ptr<std::vector<std::shared_ptr<Variable>>> variables;
+	std::shared_ptr<std::vector<std::shared_ptr<Function>>> functions;
+	std::shared_ptr<std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>> operators;
+	std::unordered_map<const OperatorFunction *, uint8_t> operator_indices;
+
+	// Constants and variables (block variables and temporaries) only used by the main chunk of
+	// the input being compiled. They are released once it has run, so that they do not add up
+	// over the inputs of the REPL or of `--stream`, and their slots are reused
+	std::bitset<UINT8_MAX + 1> input_constants, input_variables;
+	std::vector<uint8_t> free_constants, free_variables;
+
+	// Add an entry in a released slot if there is one. Return nullopt if the table is full
+	std::optional<uint8_t> add_constant(std::shared_ptr<MathObj> constant, ConstantKey key);
+	std::optional<uint8_t> add_variable(std::shared_ptr<Variable> variable);
+	// Entries used by a function body or declared in the global scope outlive the input
+	void keep_constant(uint8_t index) { input_constants.reset(index); }
+	void keep_variable(uint8_t index) { input_variables.reset(index); }
+	// Called once the main chunk of an input has run (it is not run again)
+	void release_input(void);
+
+	// Size of the tables before an input was compiled, to drop the entries it added (when its
+	// statements are compiled again in parts, see `VM::interpret_parsed()`)
+	struct Checkpoint
+	{
+		size_t constants = 0, variables = 0, functions = 0, operators = 0;
+		std::bitset<UINT8_MAX + 1> input_constants, input_variables;
+		std::vector<uint8_t> free_constants, free_variables;
+	};
+	Checkpoint checkpoint(void) const;
+	void rollback(const Checkpoint & checkpoint);
+	// The input took at most half of the constants and of the variables that were free at `checkpoint`
+	bool took_at_most_half(const Checkpoint & checkpoint) const;
+};
+
+#endif // SESSION_H
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "token.h"
+#include "parser.h"
+#include "error.h"
+#include "symbol.h"
+
+// Top-level statements run together by `VM::interpret_stream()`
+struct StreamBatch
+{
+	std::vector<Token> tokens; // They end with EOF
+	// Lines of the source the statements are on (the positions of the tokens are relative to it)
+	std::string_view text;
+	size_t first_line = 1; // Line of the file `text` starts on
+	bool at_end = false; // Only EOF was left
+
+	// With `--pipeline`, the batch is scanned and parsed on other threads, which hand over their
+	// errors (and their exception if one was thrown)
+	std::unique_ptr<Parser> parser;
+	std::vector<std::unique_ptr<Error>> errors;
+	std::exception_ptr failure;
+};
+
+// Splits a source into batches of whole top-level statements. Each batch is scanned from the
+// start of the line it begins on, so that its positions stay small and its errors are located
+// in the file without indexing the lines before it
+class StatementScanner
+{
+public:
+	StatementScanner(std::string_view source, std::shared_ptr<SymbolTable> symbols, size_t batch_tokens) :
+		source(source),
+		symbols(std::move(symbols)),
+		batch_tokens(batch_tokens)
+	{}
+
+	StreamBatch next(void);
+
+private:
+	std::string_view source;
+	std::shared_ptr<SymbolTable> symbols;
+	size_t batch_tokens; // About as many tokens are scanned for each batch
+
+	size_t line = 1, line_start = 0; // Line the next batch begins on
+	size_t position = 0; // Where the next batch begins
+};
+
+#endif // STREAM_H
\ No newline at end of file
@@ -1,36 +1,109 @@
 #ifndef VM_H
 #define VM_H
 
+#include <cstdint>
+#include <iostream>
+#include <ostream>
 #include <string_view>
 #include <memory>
 #include <stack>
+#include <vector>
 
 #include "chunk.h"
 #include "mathobj.h"
 #include "scope.h"
+#include "memo.h"
+#include "session.h"
+#include "output.h"
+#include "token.h"
+#include "stream.h"
+
+class Compiler;
+
+// Function call in progress
+struct CallFrame
+{
+	std::shared_ptr<CustomFunction> function;
+	bool memoize; // Store the result in the memo table of the function
+	MemoTable::Key memo_key;
+};
 
 class VM
 {
 private:
 	std::shared_ptr<Chunk> chunk;
 	std::stack<std::shared_ptr<MathObj>> stack;
+	std::vector<CallFrame> frames;
 	std::shared_ptr<Scope> current_scope;
+	Session session; // Kept across REPL inputs
+	OutputBuffer output; // Flushed at the end of each run
+
+	// Compiler of the source being run (function bodies are compiled on their first call)
+	Compiler * compiler;
+	std::string_view source;
+	bool interactive; // REPL or `--stream`: the AST of an input is released once it has run (functions are compiled eagerly)
+	bool ahead_of_time = false; // Compiling a program to save it (see `compile_image()`)
+	bool quiet = false; // Errors are discarded instead of reported
+	size_t first_line = 1; // Line of the file `source` starts on (see `interpret_stream()`)
+	std::string_view restored_output; // Output of a loaded snapshot, printed when it is executed
+
+	bool interpret_tokens(std::vector<Token> tokens, std::string_view source);
+	bool interpret_parsed(Parser & parser, std::string_view source);
+	// Analyzes, compiles and runs top-level statements. If `fitting` is set (to their number) and they
+	// need more entries than the tables of the session have left, nothing is run or reported: what they
+	// added is dropped and false is returned, with `fitting` set to the number of statements to try
+	// alone (fewer than before). It is doubled if they ran and took at most half of the free entries
+	bool interpret_statements(AST & ast, std::string_view source, size_t * fitting);
+	size_t part_statements = SIZE_MAX; // Top-level statements of an interactive input run together
+	bool interpret_batch(StreamBatch & batch);
+
+	// Reports the errors found so far (or discards them)
+	bool has_errors(std::string_view source);
+
+	// Returns true if the result of the call was found in the memo table (and pushed on the stack)
+	bool call_memoized(CallFrame & frame);
 
 public:
-	VM() :
+	VM(bool interactive = false, std::ostream & out = std::cout) :
 		current_scope(new Scope),
-		constants(new std::vector<std::shared_ptr<MathObj>>()),
-		variables(new std::vector<std::shared_ptr<Variable>>()),
-		functions(new std::vector<std::shared_ptr<Function>>()),
-		operators(new std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>())
+		output(out),
+		compiler(nullptr),
+		interactive(interactive)
 	{}
 
-	std::shared_ptr<std::vector<std::shared_ptr<MathObj>>> constants;
-	std::shared_ptr<std::vector<std::shared_ptr<Variable>>> variables;
-	std::shared_ptr<std::vector<std::shared_ptr<Function>>> functions;
-	std::shared_ptr<std::vector<std::pair<std::shared_ptr<const OperatorFunction>, std::string>>> operators;
+	// Returns false if the source has errors. With `config::compile_only`, the program is
+	// compiled (every function included) but not run, and it can be saved with `save_image()`
+	bool interpret_source(std::string_view source);
+	// Interprets the source a few top-level statements at a time (see `--stream`), so memory does
+	// not grow with the size of the source and output starts with the first statements. Must be
+	// run by an interactive VM. Returns false at the first statements with errors (the ones before
+	// them have run)
+	bool interpret_stream(std::string_view source);
+	// Same, with the batches scanned and parsed ahead on two other threads (see `--pipeline`):
+	// scanning, parsing and the rest (analysis, compilation and execution, which share the
+	// scopes and the tables of the session) overlap, so a batch costs about as much as its
+	// slowest stage. Must not print debug output
+	bool interpret_pipelined(std::string_view source);
+	// Top-level statements are run in batches of about this many tokens, as setting up a batch
+	// costs about as much as running a short statement
+	static constexpr size_t STREAM_BATCH_TOKENS = 4096;
+	static constexpr uint32_t PIPELINE_DEPTH = 4; // Batches waiting between two stages
+
+	// Compiles the whole program into an image without running it. Returns false if the
+	// program cannot be compiled ahead of time (the errors are reported unless `quiet` is set)
+	bool compile_image(std::string_view source, std::string & image, bool quiet = true);
+	void save_image(std::ostream & out);
+	// Saves the state left by the loaded program once it has run (the values of its variables and
+	// `printed`, its output) as an image that is restored instead of run
+	void save_snapshot(std::ostream & out, const std::string & printed);
 
-	void interpret_source(std::string_view source);
+	// Loads a program compiled with `mathlang -c` (see image.h), which must outlive the VM.
+	// Throws std::runtime_error if the image is invalid (the VM is left empty then).
+	// More source can be interpreted after the loaded program, which is how preludes are run
+	void load_image(std::string_view image);
+	// Runs the loaded program (a snapshot only prints its output again)
+	void execute(void);
+	void interpret_image(std::string_view image) { load_image(image); execute(); }
 	void run(void);
 };
 
@@ -4,35 +4,92 @@
 
 void Compiler::compile_source(void)
 {
-	for (auto & statement_n : ast.statements)
+	ir_functions.push_back(std::make_unique<IRFunction>(chunk->name, chunk));
+	ir = ir_functions.back().get();
+
+	for (NodeIndex statement_n : ast.statements)
 	{
-		compile_statement(statement_n.get());
+		compile_statement(statement_n);
+	}
+	ir->append(IRInstruction(IROpCode::I_RETURN));
+
+	generate_bytecode(*ir);
+}
+
+void Compiler::compile_function(std::shared_ptr<CustomFunction> function)
+{
+	auto it = pending_functions.find(function.get());
+	if (it == pending_functions.end())
+		return;
+	auto [func_decl_n, declaration_scope] = it->second;
+	pending_functions.erase(it);
+
+	auto & name = ast.get<IdentifierNode>(func_decl_n->name).name;
+	function->chunk = std::make_shared<Chunk>(name);
+	function->chunk->parent = chunk;
+
+	// The function body is built into its own IR function, in the scope of the declaration
+	IRFunction * enclosing_ir = ir;
+	auto enclosing_scope = scope;
+	ir_functions.push_back(std::make_unique<IRFunction>(name, function->chunk));
+	ir = ir_functions.back().get();
+	scope = declaration_scope;
+
+	enter_function(scope, function);
+	auto parameters = ast.list(func_decl_n->parameters);
+	for (auto it = parameters.rbegin(); it != parameters.rend(); ++it)
+	{
+		compile_parameter(&ast.get<ParameterNode>(*it));
+	}
+
+	for (NodeIndex statement_n : ast.list(ast.get<BlockNode>(func_decl_n->body).statements))
+	{
+		compile_statement(statement_n);
+	}
+	ir->append(IRInstruction(IROpCode::I_LEAVE_FUNCTION, func_decl_n));
+	leave_scope(scope);
+
+	generate_bytecode(*ir);
+
+	ir = enclosing_ir;
+	scope = enclosing_scope;
+}
+
+void Compiler::compile_pending_functions(void)
+{
+	// In order of declaration (functions declared in a compiled body are appended), and the
+	// functions of previous inputs are compiled already
+	for (size_t i = first_function; i < functions->size(); i++)
+	{
+		auto & function = (*functions)[i];
+		if (function->type == FunctionType::F_CUSTOM)
+			compile_function(std::static_pointer_cast<CustomFunction>(function));
 	}
-	emit(OP_RETURN);
 }
 
 void Compiler::compile_block(const BlockNode * block_n)
 {
 	if (scope->children.size() >= UINT8_MAX)
 	{
-		register_compile_error("too many scopes", "", block_n);
+		register_full_table("too many scopes", block_n);
 		return;
 	}
 
 	enter_scope(scope, block_n->relative_index);
-	emit(OP_ENTER_BLOCK);
-	for (auto & statement_n : block_n->statements)
+	ir->append(IRInstruction(IROpCode::I_ENTER_BLOCK, block_n));
+	for (NodeIndex statement_n : ast.list(block_n->statements))
 	{
-		compile_statement(statement_n.get());
+		compile_statement(statement_n);
 	}
 	leave_scope(scope);
-	emit(OP_LEAVE_BLOCK);
+	ir->append(IRInstruction(IROpCode::I_LEAVE_BLOCK, block_n));
 }
 
 void Compiler::compile_return_statement(const ReturnStatementNode * return_statement_n)
 {
-	compile_expression(return_statement_n->value.get());
-	emit(OP_RETURN_VALUE);
+	IRInstruction return_value(IROpCode::I_RETURN_VALUE, return_statement_n);
+	return_value.operands.push_back(compile_expression(return_statement_n->value));
+	ir->append(std::move(return_value));
 }
 
 void Compiler::compile_function_declaration(const FunctionDeclarationNode * func_decl_n)
@@ -44,133 +101,87 @@ void Compiler::compile_function_declaration(const FunctionDeclarationNode * func
 	}
 
 	uint8_t arg = functions->size();
-	auto function = func_decl_n->function;
-	functions->push_back(function);
-
-	std::string function_key(func_decl_n->name->name);
-    for (const auto & param : func_decl_n->parameters)
-    {
-        function_key += "_" + mathobjtype_to_string(param->type->type.type);
-    }
-
-	scope->function_indices[function_key] = arg;
-
-	function->chunk = std::make_shared<Chunk>(func_decl_n->name->name);
-	function->chunk->parent = chunk;
-	chunk = function->chunk;
-
-	enter_function(scope, function);
-	for (auto it = func_decl_n->parameters.rbegin(); it != func_decl_n->parameters.rend(); ++it)
-	{
-		compile_parameter(it->get());
-	}
+	auto * function = func_decl_n->function;
+	functions->push_back(function->shared_from_this());
 
-	for (auto & statement_n : func_decl_n->body->statements)
-	{
-		compile_statement(statement_n.get());
-	}
-	emit(OP_LEAVE_FUNCTION);
-	leave_scope(scope);
+	scope->function_indices[function->signature] = arg;
 
-	chunk = chunk->parent;
+	// Only a stub for now, the chunk is created by `compile_function()`
+	pending_functions[function] = { func_decl_n, scope };
 }
 
-void Compiler::compile_function_call(const FunctionCallNode * func_call_n)
+IRValue Compiler::compile_function_call(const FunctionCallNode * func_call_n)
 {
-	std::string function_key(func_call_n->name->name);
-    for (const auto & arg : func_call_n->function->parameters)
-    {
-        function_key += "_" + mathobjtype_to_string(arg.second.type);
-    }
-
-	uint8_t arg = scope->find_function_index(function_key);
-
-	for (auto & arg_n : func_call_n->arguments)
+	IRInstruction call(IROpCode::I_CALL, func_call_n->function->return_type, func_call_n);
+	auto index = scope->find_function_index(func_call_n->function->signature);
+	if (!index)
+		// just in case of a bug
+		throw std::runtime_error("function `" + func_call_n->function->name + "` not found");
+	call.index = *index;
+
+	for (NodeIndex arg_n : ast.list(func_call_n->arguments))
 	{
-		compile_expression(arg_n.get());
+		call.operands.push_back(compile_expression(arg_n));
 	}
 
-	emit(OP_CALL_FUNCTION, arg);
+	return ir->append(std::move(call));
 }
 
 void Compiler::compile_parameter(const ParameterNode * parameter_n)
 {
-	if (variables->size() >= UINT8_MAX)
+	SymbolId name = ast.get<IdentifierNode>(parameter_n->name).symbol;
+	auto variable = scope->find_variable(name);
+	auto index = session.add_variable(variable->second);
+	if (!index)
 	{
-		register_compile_error("too many variables", "", parameter_n);
+		register_full_table("too many variables", parameter_n);
 		return;
 	}
+	uint8_t arg = *index;
+	scope->variable_indices[name] = arg;
 
-	uint8_t arg = variables->size();
-	auto variable = scope->find_variable(parameter_n->name->name);
-	variables->push_back(variable->second);
-	scope->variable_indices[std::string(parameter_n->name->name)] = arg;
-
-	if (parameter_n->default_value)
+	if (parameter_n->default_value != NO_NODE)
 	{
 		// TODO: for later
 	}
 	else
 	{
-		emit(OP_SET_VAR, arg);
+		IRInstruction set_param(IROpCode::I_SET_PARAM, parameter_n);
+		set_param.index = arg;
+		ir->append(std::move(set_param));
 	}
 }
 
-void Compiler::compile_statement(const ASTNode * statement_n)
+void Compiler::compile_statement(NodeIndex statement_n)
 {
-	switch (statement_n->n_type)
+	const ASTNode & node = ast.node(statement_n);
+	switch (node.n_type)
 	{
 		case NodeType::N_BLOCK:
-		{
-			auto block_n = dynamic_cast<const BlockNode *>(statement_n);
-			if (!block_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_statement()`");
-
-			compile_block(block_n);
+			compile_block(&ast.get<BlockNode>(statement_n));
 			break;
-		}
 		case NodeType::N_FUNC_DECL:
-		{
-			auto func_decl_n = dynamic_cast<const FunctionDeclarationNode *>(statement_n);
-			if (!func_decl_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_statement()`");
-
-			compile_function_declaration(func_decl_n);
+			compile_function_declaration(&ast.get<FunctionDeclarationNode>(statement_n));
 			break;
-		}
 		case NodeType::N_EXPR_STMT:
 		{
-			auto expr_stmt_n = dynamic_cast<const ExpressionStatementNode *>(statement_n);
-			if (!expr_stmt_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_statement()`");
+			auto & expr_stmt_n = ast.get<ExpressionStatementNode>(statement_n);
 
-			for (auto &expression_n : expr_stmt_n->expressions)
+			// The values are discarded (they have no uses)
+			for (NodeIndex expression_n : ast.list(expr_stmt_n.expressions))
 			{
-				compile_expression(expression_n.get());
-				emit(OP_POP);
+				compile_expression(expression_n);
 			}
 			break;
 		}
 		case NodeType::N_VAR_DECL:
-		{
-			auto var_decl_n = dynamic_cast<const VariableDeclarationNode *>(statement_n);
-			if (!var_decl_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_statement()`");
-
-			compile_variable_declaration(var_decl_n);
+			compile_variable_declaration(&ast.get<VariableDeclarationNode>(statement_n));
 			break;
-		}
 		case NodeType::N_RETURN_STMT:
-		{
-			auto return_stmt_n = dynamic_cast<const ReturnStatementNode *>(statement_n);
-			if (!return_stmt_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_statement()`");
-
-			compile_return_statement(return_stmt_n);
+			compile_return_statement(&ast.get<ReturnStatementNode>(statement_n));
 			break;
-		}
 		case NodeType::N_RETURN:
-			emit(OP_RETURN);
+			ir->append(IRInstruction(IROpCode::I_RETURN, &node));
 			break;
 		default:
 			throw std::runtime_error("unknown statement type");
@@ -179,194 +190,192 @@ void Compiler::compile_statement(const ASTNode * statement_n)
 
 void Compiler::compile_variable_declaration(const VariableDeclarationNode * var_decl_n)
 {
-	if (variables->size() >= UINT8_MAX)
+	SymbolId name = ast.get<IdentifierNode>(var_decl_n->name).symbol;
+	auto variable = scope->find_variable(name);
+	auto index = session.add_variable(variable->second);
+	if (!index)
 	{
-		register_compile_error("too many variables", "", var_decl_n);
+		register_full_table("too many variables", var_decl_n);
 		return;
 	}
+	uint8_t arg = *index;
+	scope->variable_indices[name] = arg;
+	if (!scope->parent)
+		session.keep_variable(arg); // Later inputs can use it
 
-	uint8_t arg = variables->size();
-	auto variable = scope->find_variable(var_decl_n->name->name);
-	variables->push_back(variable->second);
-	scope->variable_indices[std::string(var_decl_n->name->name)] = arg;
-
-	if (var_decl_n->value)
+	if (var_decl_n->value != NO_NODE)
 	{
-		compile_expression(var_decl_n->value.get());
-		emit(OP_SET_VAR, arg);
+		IRInstruction set_var(IROpCode::I_SET_VAR, var_decl_n);
+		set_var.index = arg;
+		set_var.operands.push_back(compile_expression(var_decl_n->value));
+		ir->append(std::move(set_var));
 	}
 }
 
-void Compiler::compile_expression(const ASTNode * expression_n)
+IRValue Compiler::compile_expression(NodeIndex expression_n)
 {
-	switch (expression_n->n_type)
+	size_t base = expression_stack.size();
+	expression_stack.push_back({ expression_n, false });
+
+	// Operands are compiled from left to right, each operator after its operands
+	while (expression_stack.size() > base)
 	{
-		case NodeType::N_OPERAND:
-		{
-			auto operand_n = dynamic_cast<const OperandNode *>(expression_n);
-			if (!operand_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_expression()`");
-			compile_operand(operand_n);
-			break;
-		}
-		case NodeType::N_EXPR:
-		{
-			auto expr_n = dynamic_cast<const ExpressionNode *>(expression_n);
-			if (!expr_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_expression()`");
-			compile_expression(expr_n->left.get());
-			compile_expression(expr_n->right.get());
-			compile_binary_operator(expr_n->op.get());
-			break;
-		}
-		case NodeType::N_IDENTIFIER:
-		{
-			auto identifier_n = dynamic_cast<const IdentifierNode *>(expression_n);
-			if (!identifier_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_expression()`");
-			compile_identifier(identifier_n);
-			break;
-		}
-		case NodeType::N_LITERAL:
+		ExpressionFrame frame = expression_stack.back();
+		expression_stack.pop_back();
+		const ASTNode & node = ast.node(frame.node);
+
+		if (frame.operands_compiled)
 		{
-			auto literal_n = dynamic_cast<const LiteralNode *>(expression_n);
-			if (!literal_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_expression()`");
-			compile_literal(literal_n);
-			break;
+			IRValue rhs = operand_values.back();
+			operand_values.pop_back();
+			if (node.n_type == NodeType::N_OPERAND)
+			{
+				operand_values.push_back(compile_unary_operator(&ast.get<OperatorNode>(ast.get<OperandNode>(frame.node).op), rhs));
+				continue;
+			}
+
+			IRValue lhs = operand_values.back();
+			operand_values.pop_back();
+			auto & expr_n = ast.get<ExpressionNode>(frame.node);
+			auto & operator_n = ast.get<OperatorNode>(expr_n.op);
+			if (operator_n.op_info->name == "=")
+				operand_values.push_back(compile_assignment(&operator_n, lhs, rhs));
+			else
+				operand_values.push_back(compile_binary_operator(&operator_n, lhs, rhs));
+			continue;
 		}
-		case NodeType::N_FUNC_CALL:
+
+		switch (node.n_type)
 		{
-			auto func_call_n = dynamic_cast<const FunctionCallNode *>(expression_n);
-			if (!func_call_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_expression()`");
-			compile_function_call(func_call_n);
-			break;
+			case NodeType::N_OPERAND:
+			{
+				auto & operand_n = ast.get<OperandNode>(frame.node);
+				if (operand_n.op != NO_NODE)
+					expression_stack.push_back({ frame.node, true });
+				expression_stack.push_back({ operand_n.primary, false });
+				break;
+			}
+			case NodeType::N_EXPR:
+			{
+				auto & expr_n = ast.get<ExpressionNode>(frame.node);
+				expression_stack.push_back({ frame.node, true });
+				expression_stack.push_back({ expr_n.right, false });
+				// The semantic analyzer made sure that the left-hand side of an assignment is a variable
+				if (ast.get<OperatorNode>(expr_n.op).op_info->name == "=")
+					operand_values.push_back(compile_reference(&ast.get<IdentifierNode>(expr_n.left)));
+				else
+					expression_stack.push_back({ expr_n.left, false });
+				break;
+			}
+			case NodeType::N_IDENTIFIER:
+				operand_values.push_back(compile_identifier(&ast.get<IdentifierNode>(frame.node)));
+				break;
+			case NodeType::N_LITERAL:
+				operand_values.push_back(compile_literal(&ast.get<LiteralNode>(frame.node)));
+				break;
+			case NodeType::N_FUNC_CALL:
+				operand_values.push_back(compile_function_call(&ast.get<FunctionCallNode>(frame.node)));
+				break;
+			default:
+				throw std::runtime_error("unknown expression type");
 		}
-		default:
-			throw std::runtime_error("unknown expression type");
 	}
+
+	IRValue value = operand_values.back();
+	operand_values.pop_back();
+	return value;
 }
 
-void Compiler::compile_operand(const OperandNode * operand_n)
+IRValue Compiler::compile_assignment(const OperatorNode * operator_n, IRValue reference, IRValue value)
 {
-	switch (operand_n->primary->n_type)
-	{
-		case NodeType::N_EXPR:
-		{
-			compile_expression(operand_n->primary.get());
-			break;
-		}
-		case NodeType::N_OPERAND:
-		{
-			auto _operand_n = dynamic_cast<const OperandNode *>(operand_n->primary.get());
-			if (!_operand_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_operand()`");
-			compile_operand(_operand_n);
-			break;
-		}
-		case NodeType::N_IDENTIFIER:
-		{
-			auto identifier_n = dynamic_cast<IdentifierNode *>(operand_n->primary.get());
-			if (!identifier_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_operand()`");
-			compile_identifier(identifier_n);
-			break;
-		}
-		case NodeType::N_LITERAL:
-		{
-			auto literal_n = dynamic_cast<LiteralNode *>(operand_n->primary.get());
-			if (!literal_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_operand()`");
-			compile_literal(literal_n);
-			break;
-		}
-		case NodeType::N_FUNC_CALL:
-		{
-			auto func_call_n = dynamic_cast<FunctionCallNode *>(operand_n->primary.get());
-			if (!func_call_n)
-				throw std::logic_error("downcasting failed in `Compiler::compile_operand()`");
-			compile_function_call(func_call_n);
-			break;
-		}
-		default:
-			throw std::logic_error("Invalid node type in `Compiler::compile_operand()`");
-	}
-
-	if (operand_n->op)
-		compile_unary_operator(operand_n->op.get());
+	IRInstruction assign(IROpCode::I_ASSIGN, operator_n->op_func->return_type, operator_n);
+	assign.op_func = operator_n->op_func->shared_from_this();
+	assign.op_name = operator_n->op_info->name;
+	assign.operands.push_back(reference);
+	assign.operands.push_back(value);
+	return ir->append(std::move(assign));
 }
 
-void Compiler::compile_operator(const OperatorNode * operator_n, bool unary)
+IRValue Compiler::compile_operator(const OperatorNode * operator_n, std::vector<IRValue> operands, bool unary)
 {
-	auto op_func = operator_n->op_func;
-	if (operators->size() >= UINT8_MAX)
-		throw std::runtime_error("too many operators");
+	auto op_func = operator_n->op_func->shared_from_this();
 
-	auto pair = std::make_pair(op_func, operator_n->op_info->name);
-	operators->push_back(pair);
+	IRInstruction instruction(unary ? IROpCode::I_UNARY : IROpCode::I_BINARY, op_func->return_type, operator_n);
+	instruction.op_func = op_func;
+	instruction.op_name = operator_n->op_info->name;
+	instruction.operands = std::move(operands);
+	return ir->append(std::move(instruction));
+}
+
+IRValue Compiler::compile_binary_operator(const OperatorNode * operator_n, IRValue lhs, IRValue rhs)
+{ return compile_operator(operator_n, { lhs, rhs }, false); }
+
+IRValue Compiler::compile_unary_operator(const OperatorNode * operator_n, IRValue operand)
+{ return compile_operator(operator_n, { operand }, true); }
+
+IRValue Compiler::compile_identifier(const IdentifierNode * identifier_n)
+{
+	uint8_t variable = find_variable_index(identifier_n);
 
-	emit(unary ? OP_UNARY_OP : OP_BINARY_OP, operators->size() - 1);
+	auto & var = (*variables)[variable];
+	IRInstruction load(IROpCode::I_LOAD_VAR, MathObjType(var->value_type().type, var->is_const()), identifier_n);
+	load.index = variable;
+	return ir->append(std::move(load));
 }
 
-void Compiler::compile_binary_operator(const OperatorNode * operator_n)
-{ compile_operator(operator_n, false); }
+IRValue Compiler::compile_reference(const IdentifierNode * identifier_n)
+{
+	uint8_t variable = find_variable_index(identifier_n);
 
-void Compiler::compile_unary_operator(const OperatorNode * operator_n)
-{ compile_operator(operator_n, true); }
+	auto & var = (*variables)[variable];
+	IRInstruction reference(IROpCode::I_VAR_REF, MathObjType(var->value_type().type, var->is_const()), identifier_n);
+	reference.index = variable;
+	return ir->append(std::move(reference));
+}
 
-void Compiler::compile_identifier(const IdentifierNode * identifier_n)
+uint8_t Compiler::find_variable_index(const IdentifierNode * identifier_n)
 {
-	std::string name = std::string(identifier_n->name);
-	uint8_t variable = scope->find_variable_index(name);
-	emit(OP_LOAD_VAR, variable);
+	auto variable = scope->find_variable_index(identifier_n->symbol);
+	if (!variable)
+		// just in case of a bug
+		throw std::runtime_error("variable `" + std::string(identifier_n->name) + "` not found");
+	return *variable;
 }
 
-void Compiler::compile_literal(const LiteralNode * literal_n)
+IRValue Compiler::compile_literal(const LiteralNode * literal_n)
 {
 	switch (literal_n->type.type)
 	{
 		case MathObjType::MO_INTEGER: case MathObjType::MO_REAL:
-			compile_constant(literal_n);
-			break;
+			return compile_constant(literal_n);
 	}
+	return IR_NO_VALUE;
 }
 
-void Compiler::compile_constant(const LiteralNode * literal_n)
+IRValue Compiler::compile_constant(const LiteralNode * literal_n)
 {
-	if (constants->size() >= UINT8_MAX)
-	{
-		register_compile_error("too many constants", "", literal_n);
-		return;
-	}
-
-	// Check if the constant already exists in the unordered map
-	auto it = constant_indices.find(std::string(literal_n->value));
-	if (it != constant_indices.end())
-	{
-		emit(OP_LOAD_CONST, it->second);
-		return;
-	}
-
+	IRInstruction constant(IROpCode::I_CONST, MathObjType(literal_n->type.type), literal_n);
+	// Literals are deduplicated by their value (converted by the parser)
 	switch (literal_n->type.type)
 	{
 		case MathObjType::MO_INTEGER:
-		{
-			auto constant = std::make_shared<Integer>(std::stoi(literal_n->value.data()));
-			constants->push_back(constant);
-			emit(OP_LOAD_CONST, constants->size() - 1);
-			constant_indices[std::string(literal_n->value)] = constants->size() - 1;
+			constant.constant_key = ConstantKey::of(literal_n->integer);
 			break;
-		}
 		case MathObjType::MO_REAL:
-		{
-			auto constant = std::make_shared<Real>(std::stod(literal_n->value.data()));
-			constants->push_back(constant);
-			emit(OP_LOAD_CONST, constants->size() - 1);
-			constant_indices[std::string(literal_n->value)] = constants->size() - 1;
+			constant.constant_key = ConstantKey::of(literal_n->real);
 			break;
-		}
 	}
+
+	// The object is only made for the first use of the value (the others share its slot)
+	auto it = constant_indices.find(constant.constant_key);
+	if (it != constant_indices.end())
+		constant.constant = (*constants)[it->second];
+	else if (literal_n->type.type == MathObjType::MO_INTEGER)
+		constant.constant = std::make_shared<Integer>(literal_n->integer);
+	else
+		constant.constant = std::make_shared<Real>(literal_n->real);
+
+	return ir->append(std::move(constant));
 }
 
 void Compiler::emit(uint8_t op_code)
@@ -377,6 +386,14 @@ void Compiler::emit(uint8_t op_code, uint8_t arg)
 {
 	emit(op_code);
 	emit(arg);
+
+	// Function bodies outlive the input, and so do the entries they use
+	if (!lowering_function_body)
+		return;
+	if (op_code == OpCode::OP_LOAD_CONST)
+		session.keep_constant(arg);
+	else if (op_code == OpCode::OP_SET_VAR || op_code == OpCode::OP_LOAD_VAR)
+		session.keep_variable(arg);
 }
 
 void Compiler::register_compile_error(std::string message, std::string additional_info, const ASTNode * node)
@@ -384,10 +401,15 @@ void Compiler::register_compile_error(std::string message, std::string additiona
 	std::unique_ptr<Error> err { new CompileError(
 		message,
 		additional_info,
-		node->line,
-		node->column,
-		node->start_position,
+		node->location,
 		node->end_position - node->start_position
 	)};
 	ErrorHandler::push_error(err);
+}
+
+void Compiler::register_full_table(std::string message, const ASTNode * node)
+{
+	if (!full_table_node || node->start_position < full_table_node->start_position)
+		full_table_node = node;
+	register_compile_error(message, "", node);
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include <algorithm>
+
+#include "compiler.h"
+#include "passmanager.h"
+#include "globals.h"
+#include "error.h"
+
+/* Lowering from the SSA form to stack bytecode.
+   A value stays on the VM stack between its definition and its use whenever the
+   stack discipline allows it. Otherwise it is spilled: rematerializable values
+   (constants and variable loads) are emitted again at each use, and the others are
+   stored into a temporary variable slot right after they are computed.
+*/
+
+size_t count_resident_operands(const std::vector<IRValue> & stack, const IRInstruction & instruction, const std::vector<bool> & spilled);
+
+void Compiler::generate_bytecode(IRFunction & function)
+{
+	auto pass_manager = PassManager::for_level(config::optimization_level, *operator_table);
+	pass_manager.run(function);
+	lower(function);
+}
+
+void Compiler::lower(IRFunction & function)
+{
+	auto uses = function.use_counts();
+	auto defs = function.definitions();
+
+	std::vector<bool> spilled(function.next_value);
+	for (IRValue value = 0; value < function.next_value; value++)
+		spilled[value] = uses[value] > 1;
+
+	// Spilling a value changes the shape of the stack, so repeat until no other value has to be spilled
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		std::vector<IRValue> stack;
+		for (auto & instruction : function.instructions)
+		{
+			size_t resident = count_resident_operands(stack, instruction, spilled);
+			for (size_t i = resident; i < instruction.operands.size(); i++)
+			{
+				if (!spilled[instruction.operands[i]])
+				{
+					spilled[instruction.operands[i]] = true;
+					changed = true;
+				}
+			}
+			stack.resize(stack.size() - resident);
+
+			if (instruction.has_result() && uses[instruction.result] > 0 && !spilled[instruction.result])
+				stack.push_back(instruction.result);
+		}
+	}
+
+	chunk = function.chunk;
+	chunk->bytes.clear();
+	lowering_function_body = chunk != ir_functions.front()->chunk;
+
+	std::vector<IRValue> stack;
+	std::vector<uint8_t> slots(function.next_value);
+	std::vector<uint8_t> free_slots;
+	for (auto & instruction : function.instructions)
+	{
+		size_t resident = count_resident_operands(stack, instruction, spilled);
+		stack.resize(stack.size() - resident);
+
+		// Push the operands that are not already on the stack
+		for (size_t i = resident; i < instruction.operands.size(); i++)
+		{
+			IRValue operand = instruction.operands[i];
+			auto & def = function.instructions[defs[operand]];
+			if (def.is_rematerializable())
+			{
+				lower_instruction(def);
+				continue;
+			}
+
+			emit(OpCode::OP_LOAD_VAR, slots[operand]);
+			if (--uses[operand] == 0)
+				free_slots.push_back(slots[operand]);
+		}
+
+		if (!instruction.has_result())
+		{
+			lower_instruction(instruction);
+			continue;
+		}
+
+		// Emitted at each use instead
+		if (spilled[instruction.result] && instruction.is_rematerializable())
+			continue;
+
+		lower_instruction(instruction);
+		if (uses[instruction.result] == 0)
+		{
+			emit(OpCode::OP_POP);
+		}
+		else if (spilled[instruction.result])
+		{
+			slots[instruction.result] = allocate_temporary(free_slots, instruction);
+			emit(OpCode::OP_SET_VAR, slots[instruction.result]);
+		}
+		else
+		{
+			stack.push_back(instruction.result);
+		}
+	}
+
+	chunk = ir_functions.front()->chunk;
+}
+
+void Compiler::lower_instruction(const IRInstruction & instruction)
+{
+	switch (instruction.op)
+	{
+		case IROpCode::I_CONST:
+			lower_constant(instruction);
+			break;
+		case IROpCode::I_LOAD_VAR:
+		case IROpCode::I_VAR_REF:
+			emit(OpCode::OP_LOAD_VAR, instruction.index);
+			break;
+		case IROpCode::I_SET_VAR:
+		case IROpCode::I_SET_PARAM:
+			emit(OpCode::OP_SET_VAR, instruction.index);
+			break;
+		case IROpCode::I_ASSIGN:
+		case IROpCode::I_BINARY:
+			lower_operator(instruction, false);
+			break;
+		case IROpCode::I_UNARY:
+			lower_operator(instruction, true);
+			break;
+		case IROpCode::I_CALL:
+			emit(OpCode::OP_CALL_FUNCTION, instruction.index);
+			break;
+
+		case IROpCode::I_ENTER_BLOCK:
+			emit(OpCode::OP_ENTER_BLOCK);
+			break;
+		case IROpCode::I_LEAVE_BLOCK:
+			emit(OpCode::OP_LEAVE_BLOCK);
+			break;
+
+		case IROpCode::I_RETURN:
+			emit(OpCode::OP_RETURN);
+			break;
+		case IROpCode::I_RETURN_VALUE:
+			emit(OpCode::OP_RETURN_VALUE);
+			break;
+		case IROpCode::I_LEAVE_FUNCTION:
+			emit(OpCode::OP_LEAVE_FUNCTION);
+			break;
+	}
+}
+
+void Compiler::lower_constant(const IRInstruction & instruction)
+{
+	// Check if the constant already exists in the unordered map
+	auto it = constant_indices.find(instruction.constant_key);
+	if (it != constant_indices.end())
+	{
+		emit(OpCode::OP_LOAD_CONST, it->second);
+		return;
+	}
+
+	auto index = session.add_constant(instruction.constant, instruction.constant_key);
+	if (!index)
+	{
+		register_full_table("too many constants", instruction.node);
+		return;
+	}
+	emit(OpCode::OP_LOAD_CONST, *index);
+}
+
+void Compiler::lower_operator(const IRInstruction & instruction, bool unary)
+{
+	OpCode op_code = unary ? OpCode::OP_UNARY_OP : OpCode::OP_BINARY_OP;
+
+	// Each implementation has a single entry in the operators table
+	auto it = operator_indices.find(instruction.op_func.get());
+	if (it != operator_indices.end())
+	{
+		emit(op_code, it->second);
+		return;
+	}
+
+	if (operators->size() >= UINT8_MAX)
+	{
+		register_compile_error("too many operators", "", instruction.node);
+		return;
+	}
+
+	operators->push_back(std::make_pair(instruction.op_func, instruction.op_name));
+	emit(op_code, operators->size() - 1);
+	operator_indices[instruction.op_func.get()] = operators->size() - 1;
+}
+
+uint8_t Compiler::allocate_temporary(std::vector<uint8_t> & free_slots, const IRInstruction & instruction)
+{
+	if (!free_slots.empty())
+	{
+		uint8_t slot = free_slots.back();
+		free_slots.pop_back();
+		return slot;
+	}
+
+	// Temporaries are named `%t<n>` so they cannot clash with user variables
+	auto temporary = std::make_shared<Variable>("%t" + std::to_string(temporary_count), MathObjType(instruction.type.type, false));
+	auto index = session.add_variable(std::move(temporary));
+	if (!index)
+	{
+		register_full_table("too many variables", instruction.node);
+		return 0;
+	}
+	temporary_count++;
+	return *index;
+}
+
+size_t count_resident_operands(const std::vector<IRValue> & stack, const IRInstruction & instruction, const std::vector<bool> & spilled)
+{
+	// The leading operands must be the topmost stack entries, in order
+	auto & operands = instruction.operands;
+	for (size_t count = std::min(operands.size(), stack.size()); count > 0; count--)
+	{
+		bool match = true;
+		for (size_t i = 0; i < count && match; i++)
+			match = !spilled[operands[i]] && stack[stack.size() - count + i] == operands[i];
+
+		if (match)
+			return count;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -1,31 +1,35 @@
 #include "semanalyzer.h"
 #include "error.h"
+#include "nametable.h"
 
-std::unordered_map<MOT, std::string> mathobjtype_string =
+constexpr std::pair<MOT, const char *> mathobjtype_names[] =
 {
 	{ MOT::MO_NONE,		"None"		},
 	{ MOT::MO_INTEGER,	"Integer"	},
 	{ MOT::MO_REAL,		"Real"		}
 };
+constexpr auto mathobjtype_string = make_name_table<MOT, MOT::MO_REAL - MOT::MO_NONE + 1>(mathobjtype_names, "", MOT::MO_NONE);
 
 std::string mathobjtype_to_string(MOT type)
-{ return mathobjtype_string[type]; }
+{ return mathobjtype_string[type - MOT::MO_NONE]; }
 
 void SemanticAnalyzer::analyze_source(void)
 {
 	context_stack.push(std::make_pair(ContextType::C_GLOBAL, nullptr));
-	for (const auto & statement : ast.statements)
+	for (NodeIndex statement : ast.statements)
 	{
 		panic_mode = false;
-		analyze(statement.get());
+		analyze(statement);
 	}
 }
 
-SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
+SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(NodeIndex node_index)
 {
 	if (panic_mode)
 		return MathObjType(MOT::MO_NONE);
 
+	ASTNode * node = &ast.node(node_index);
+
 	switch (node->n_type)
 	{
 		case NodeType::N_BLOCK:
@@ -43,62 +47,67 @@ SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
 
 			bool found_return = false;
 			const FunctionDeclarationNode * func_decl = nullptr;
+			MathObjType return_type;
+			if (in_function())
+			{
+				func_decl = static_cast<const FunctionDeclarationNode *>(context_stack.top().second);
+				return_type = ast.get<TypeNode>(func_decl->return_type).type;
+			}
 
-			for (const auto & statement : block->statements)
+			for (NodeIndex statement_index : ast.list(block->statements))
 			{
+				const ASTNode * statement = &ast.node(statement_index);
 				if ((statement->n_type == NodeType::N_RETURN || statement->n_type == NodeType::N_RETURN_STMT)
 					&& !in_function())
 				{
 					register_semantic_error(
 						"return statement outside of function body",
 						"",
-						statement.get()
+						statement
 					);
 				}
 				else if (in_function())
 				{
-					func_decl = static_cast<const FunctionDeclarationNode *>(context_stack.top().second);
-
-					if (statement->n_type == NodeType::N_RETURN_STMT && func_decl->return_type->type.type == MathObjType::MO_NONE)
+					if (statement->n_type == NodeType::N_RETURN_STMT && return_type.type == MathObjType::MO_NONE)
 					{
 						register_semantic_error(
 							"non-returning function should not return a value",
 							"",
-							statement.get()
+							statement
 						);
 					}
-					else if (statement->n_type == NodeType::N_RETURN && func_decl->return_type->type.type != MathObjType::MO_NONE)
+					else if (statement->n_type == NodeType::N_RETURN && return_type.type != MathObjType::MO_NONE)
 					{
 						register_semantic_error(
 							"returning function should return a value",
 							"",
-							statement.get()
+							statement
 						);
 					}
 					else if (statement->n_type == NodeType::N_RETURN_STMT)
 					{
 						found_return = true;
-						auto * return_stmt = static_cast<ReturnStatementNode *>(statement.get());
-						MathObjType expr_type = analyze(return_stmt->value.get()).type;
-						if (!can_convert(expr_type, func_decl->return_type->type))
+						auto * return_stmt = static_cast<const ReturnStatementNode *>(statement);
+						MathObjType expr_type = analyze(return_stmt->value).type;
+						if (!can_convert(expr_type, return_type))
 						{
 							register_semantic_error(
-								"cannot implicitly convert `" + mathobjtype_to_string(expr_type.type) + "` to `"+ mathobjtype_to_string(func_decl->return_type->type.type) + "`",
+								"cannot implicitly convert `" + mathobjtype_to_string(expr_type.type) + "` to `"+ mathobjtype_to_string(return_type.type) + "`",
 								"",
-								return_stmt->value.get()
+								&ast.node(return_stmt->value)
 							);
 						}
 					}
 				}
-				analyze(statement.get());
+				analyze(statement_index);
 			}
 
-			if (in_function() && func_decl->return_type->type.type != MathObjType::MO_NONE && !found_return)
+			if (in_function() && return_type.type != MathObjType::MO_NONE && !found_return)
 			{
 				register_semantic_error(
 					"returning function should return a value",
 					"",
-					func_decl->name.get()
+					&ast.node(func_decl->name)
 				);
 			}
 
@@ -109,66 +118,41 @@ SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
 		case NodeType::N_RETURN_STMT:
 		{
 			auto * return_stmt = static_cast<ReturnStatementNode *>(node);
-			return analyze(return_stmt->value.get());
+			return analyze(return_stmt->value);
 		}
 		case NodeType::N_FUNC_DECL:
 		{
 			auto * func_decl = static_cast<FunctionDeclarationNode *>(node);
-			auto & name = func_decl->name->name;
+			auto & name_n = ast.get<IdentifierNode>(func_decl->name);
+			auto & name = name_n.name;
+			auto parameters = ast.list(func_decl->parameters);
+			MathObjType return_type = ast.get<TypeNode>(func_decl->return_type).type;
 
 			context_stack.push(std::make_pair(
-				func_decl->return_type->type.type == MathObjType::MO_NONE ?
+				return_type.type == MathObjType::MO_NONE ?
 					ContextType::C_NONRETURNING_FUNCTION : ContextType::C_RETURNING_FUNCTION,
 				func_decl));
 
 			// Look for a function with the same name and same arity and parameter types
-			auto candidates = scope->get_function_implementations(std::string(name));
-			if (!candidates.empty())
+			std::vector<MOT> parameter_types;
+			for (NodeIndex param_index : parameters)
+				parameter_types.push_back(ast.get<TypeNode>(ast.get<ParameterNode>(param_index).type).type.type);
+			SymbolId signature = symbols->intern_signature(name_n.symbol, parameter_types);
+			if (scope->find_function(signature))
 			{
-				bool found_match = false;
-				// Iterate over the candidate functions and check if any of them match the parameter types
-				for (auto it = candidates.begin(); it != candidates.end(); ++it)
-				{
-					auto & func = it->second;
-					if (func->parameters.size() != func_decl->parameters.size())
-						continue;
-
-					auto & params = func->parameters;
-
-					bool match = true;
-					// Check if the candidate function has the same parameter types as the function
-					// parameters can have different names
-					for (size_t i = 0; i < func_decl->parameters.size(); ++i)
-					{
-						if (func_decl->parameters[i]->type->type.type != params[i].second.type)
-						{
-							match = false;
-							break;
-						}
-					}
-
-					if (match)
-					{
-						found_match = true;
-						break;
-					}
-				}
-
-				if (found_match)
-				{
-					register_semantic_error(
-						"function `" + std::string(name) + "` with the same parameter types is already defined in this scope",
-						"",
-						func_decl->name.get()
-					);
-					return MathObjType(MOT::MO_NONE);
-				}
+				register_semantic_error(
+					"function `" + std::string(name) + "` with the same parameter types is already defined in this scope",
+					"",
+					&ast.node(func_decl->name)
+				);
+				return MathObjType(MOT::MO_NONE);
 			}
 
 			// Add the function to the list of functions
-			auto function = std::make_shared<CustomFunction>(name, func_decl->return_type->type);
-			scope->function_table.register_function(std::string(name), function);
-			func_decl->function = function;
+			auto function = std::make_shared<CustomFunction>(name, return_type);
+			function->signature = signature;
+			scope->function_table.register_function(name_n.symbol, function);
+			func_decl->function = function.get();
 
 			if (scope->children.size() >= UINT8_MAX)
 			{
@@ -187,14 +171,17 @@ SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
 			scope->is_function_scope = true;
 
 			// Analyze the function parameters
-			for (const auto & param : func_decl->parameters)
+			for (NodeIndex param_index : parameters)
 			{
-				analyze(param.get());
-				function->parameters.push_back(std::make_pair(std::string(param->name->name), param->type->type));
+				analyze(param_index);
+				auto & param = ast.get<ParameterNode>(param_index);
+				function->parameters.push_back(std::make_pair(std::string(ast.get<IdentifierNode>(param.name).name), ast.get<TypeNode>(param.type).type));
 			}
+			// Calls in the default values saw the function without all of its parameters
+			scope->overloads.clear();
 
 			// Analyze the function body
-			analyze(func_decl->body.get());
+			analyze(func_decl->body);
 
 			leave_scope(scope);
 			context_stack.pop();
@@ -203,110 +190,78 @@ SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
 		case NodeType::N_FUNC_CALL:
 		{
 			auto * func_call = static_cast<FunctionCallNode *>(node);
-			auto & name = func_call->name->name;
+			auto & name_n = ast.get<IdentifierNode>(func_call->name);
+			auto & name = name_n.name;
+			auto arguments = ast.list(func_call->arguments);
 
 			// Look for a function with the same name and same types of arguments
-			auto candidates = scope->get_function_implementations(std::string(name));
-			auto candidates_copy = candidates;
-			if (candidates.empty())
+			if (scope->count_function_implementations(name_n.symbol) == 0)
 			{
 				register_semantic_error(
 					"function `" + std::string(name) + "` is not defined in this scope",
 					"",
-					func_call->name.get()
+					&ast.node(func_call->name)
 				);
 				return MathObjType(MOT::MO_NONE);
 			}
 
-			std::vector<std::pair<std::shared_ptr<Function>, int>> matching_candidates;
-			for (auto it = candidates.begin(); it != candidates.end(); ++it)
-			{
-				auto & func = it->second;
-				if (func->parameters.size() != func_call->arguments.size())
-					continue;
-
-				auto & params = func->parameters;
-
-				bool match = true;
-				// Check if the candidate function has the same parameter types as the function
-				// parameters can have different names
-				for (size_t i = 0; i < func_call->arguments.size(); ++i)
-				{
-					MathObjType arg_type = analyze(func_call->arguments[i].get()).type;
-					if (!can_convert(arg_type, params[i].second))
-					{
-						match = false;
-						break;
-					}
-				}
+			// Analyze the function arguments once for all the candidates
+			std::vector<MathObjType> argument_types;
+			argument_types.reserve(arguments.size());
+			for (NodeIndex arg : arguments)
+				argument_types.push_back(analyze(arg).type);
 
-				if (match)
-				{
-					int specificity = 0;
-					for (size_t i = 0; i < func_call->arguments.size(); ++i)
-					{
-						MathObjType arg_type = analyze(func_call->arguments[i].get()).type;
-						specificity += calculate_specificity(arg_type, params[i].second);
-					}
-					matching_candidates.push_back({ func, specificity });
-				}
-			}
-
-			if (matching_candidates.empty())
+			const OverloadResolution & resolution = scope->resolve_call(name_n.symbol, argument_types);
+			if (resolution.status == ResolutionStatus::R_NO_MATCH)
 			{
 				std::string additional_info = "`";
-				for (const auto & arg : func_call->arguments)
+				for (MathObjType arg_type : argument_types)
 				{
-					additional_info += mathobjtype_to_string(analyze(arg.get()).type.type) + "`, `";
+					additional_info += mathobjtype_to_string(arg_type.type) + "`, `";
 				}
 				additional_info.pop_back();
 				additional_info.pop_back();
 				additional_info.pop_back();
 
-				if (!candidates_copy.empty())
+				additional_info += "\nCandidates are : \n";
+				for (Function * func : scope->get_function_implementations(name_n.symbol))
 				{
-					additional_info += "\nCandidates are : \n";
-					for (auto it = candidates_copy.begin(); it != candidates_copy.end(); ++it)
+					additional_info += "  - " + func->name + "(";
+					for (auto & param : func->parameters)
 					{
-						auto & func = it->second;
-						additional_info += "  - " + func->name + "(";
-						for (auto & param : func->parameters)
-						{
-							additional_info += mathobjtype_to_string(param.second.type) + ", ";
-						}
-						additional_info.pop_back();
-						additional_info.pop_back();
-						additional_info += ")\n";
+						additional_info += mathobjtype_to_string(param.second.type) + ", ";
 					}
+					additional_info.pop_back();
+					additional_info.pop_back();
+					additional_info += ")\n";
 				}
 
 				register_semantic_error(
 					"no function `" + std::string(name) + "` matches these argument types",
 					additional_info,
-					func_call->name.get()
+					&ast.node(func_call->name)
 				);
 				return MathObjType(MOT::MO_NONE);
 			}
 
-			// Sort the matching candidates by specificity
-			std::sort(matching_candidates.begin(), matching_candidates.end(), [](auto & a, auto & b) {
-				return a.second > b.second;
-			});
-
 			// Check if there's a unique maximum specificity
-			if (matching_candidates.size() > 1 && matching_candidates[0].second == matching_candidates[1].second)
+			if (resolution.status == ResolutionStatus::R_AMBIGUOUS)
 			{
 				register_semantic_error(
 					"ambiguous call to function `" + std::string(name) + "`",
 					"",
-					func_call->name.get()
+					&ast.node(func_call->name)
 				);
 				return MathObjType(MOT::MO_NONE);
 			}
 
 			// Get the most specific candidate
-			auto & candidate = matching_candidates[0];
-			func_call->function = candidate.first;
+			Function * candidate = resolution.function;
+			func_call->function = candidate;
+
+			// A recursive call does not make a function impure by itself
+			if (candidate->type != FunctionType::F_CUSTOM || !static_cast<CustomFunction *>(candidate)->is_pure)
+				mark_impure();
 
 			//auto it = scope->find_function(name);
 			//if (it == scope->functions.end())
@@ -346,251 +301,311 @@ SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze(ASTNode * node)
 			//	return MathObjType::MO_NONE;
 			//}
 
-			// Analyze the function arguments
-			for (const auto & arg : func_call->arguments)
-			{
-				analyze(arg.get());
-			}
-
-			return candidate.first->return_type;
+			return candidate->return_type;
 		}
 		case NodeType::N_PARAMETER:
 		{
 			auto * param = static_cast<ParameterNode *>(node);
-			auto & param_type = param->type;
+			MathObjType param_type = ast.get<TypeNode>(param->type).type;
+			auto & param_name = ast.get<IdentifierNode>(param->name);
 
-			if (param->default_value)
+			if (param->default_value != NO_NODE)
 			{
-				MathObjType expr_type = analyze(param->default_value.get()).type;
-				if (!can_convert(expr_type, param_type->type))
+				MathObjType expr_type = analyze(param->default_value).type;
+				if (!can_convert(expr_type, param_type))
 				{
 					register_semantic_error(
-						"cannot implicitly convert `" + mathobjtype_to_string(expr_type.type) + "` to `" + mathobjtype_to_string(param_type->type.type) + "`",
+						"cannot implicitly convert `" + mathobjtype_to_string(expr_type.type) + "` to `" + mathobjtype_to_string(param_type.type) + "`",
 						"",
-						param->default_value.get()
+						&ast.node(param->default_value)
 					);
 				}
 			}
 			
 			// Add the parameter to the list of variables
-			scope->variables[param->name->name] = std::make_shared<Variable>(param->name->name, param_type->type);
+			scope->variables[param_name.symbol] = std::make_shared<Variable>(param_name.name, param_type);
 
-			return param_type->type;
+			return param_type;
 		}
 		case NodeType::N_EXPR_STMT:
 		{
 			auto * expr_stmt = static_cast<ExpressionStatementNode *>(node);
-			for (const auto & expression : expr_stmt->expressions)
-				analyze(expression.get());
+			for (NodeIndex expression : ast.list(expr_stmt->expressions))
+				analyze(expression);
 			break;
 		}
 		case NodeType::N_VAR_DECL:
 		{
 			auto * var_decl = static_cast<VariableDeclarationNode *>(node);
-			MathObjType var_type = var_decl->type->type;
+			MathObjType var_type = ast.get<TypeNode>(var_decl->type).type;
+			auto & var_name = ast.get<IdentifierNode>(var_decl->name);
 
-			if (var_decl->value)
+			if (var_decl->value != NO_NODE)
 			{
-				MathObjType expr_type = analyze(var_decl->value.get()).type;
+				MathObjType expr_type = analyze(var_decl->value).type;
 				if (!can_convert(expr_type, var_type))
 				{
 					register_semantic_error(
 						"cannot implicitly convert `" + mathobjtype_to_string(expr_type.type) + "` to `" + mathobjtype_to_string(var_type.type) + "`",
 						"",
-						var_decl->value.get()
+						&ast.node(var_decl->value)
 					);
 				}
 			}
 
 			// Look for a variable with the same name
-			auto it = scope->find_variable(var_decl->name->name, in_function());
+			auto it = scope->find_variable(var_name.symbol, in_function());
 			if (it != scope->variables.end())
 			{
 				register_semantic_error(
-					"variable `" + std::string(var_decl->name->name) + "` is already defined in this scope",
+					"variable `" + std::string(var_name.name) + "` is already defined in this scope",
 					"",
-					var_decl->name.get()
+					&ast.node(var_decl->name)
 				);
 				return var_type;
 			}
 			
 			// Add the variable to the list of variables
-			scope->variables[var_decl->name->name] = std::make_shared<Variable>(var_decl->name->name, var_type);
+			scope->variables[var_name.symbol] = std::make_shared<Variable>(var_name.name, var_type);
 
 			return var_type;
 		}
-		case NodeType::N_EXPR:
+		case NodeType::N_EXPR: case NodeType::N_OPERAND:
+			return analyze_expression(node_index);
+		case NodeType::N_LITERAL:
 		{
-			auto * expr = static_cast<ExpressionNode *>(node);
-
-			auto & op = expr->op;
-			// Check if the lhs is not a variable
-			if (op->op_info->name == "=" && expr->left->n_type != NodeType::N_IDENTIFIER)
+			auto * literal = static_cast<LiteralNode *>(node);
+			return literal->type;
+		}
+		case NodeType::N_IDENTIFIER:
+		{
+			auto * identifier = static_cast<IdentifierNode *>(node);
+			auto it = scope->find_variable(identifier->symbol);
+			if (it == scope->variables.end())
 			{
 				register_semantic_error(
-					"left-hand side of assignment must be a modifiable lvalue",
+					"variable `" + std::string(identifier->name) + "` is not defined in this scope",
 					"",
-					expr->left.get()
+					identifier
 				);
 				break;
 			}
-			
-			AnalysisResult left_info = analyze(expr->left.get());
-			AnalysisResult right_info = analyze(expr->right.get());
-
-			// Get the list of implementations for the operator
-			auto candidates = operator_table->get_implementations(op->op_info->name);
-			if (candidates.first != candidates.second)
-			{
-				std::vector<std::pair<std::shared_ptr<OperatorFunction>, int>> matching_candidates;
 
-				// Iterate over the candidate operators and check if any of them match the operand types
-				for (auto & it = candidates.first; it != candidates.second; ++it)
-				{
-					auto arg_types = it->second->arg_types;
-					int specificity = calculate_specificity(left_info.type, right_info.type, arg_types.first, arg_types.second);
+			// The value of a variable outside of the function can change between calls
+			if (in_function() && !it->second->is_const() && !is_function_local(identifier->symbol))
+				mark_impure();
 
-					if (specificity > 0)
-						matching_candidates.push_back({ it->second, specificity });
-				}
-				
-				if (!matching_candidates.empty())
-				{
-					// Sort the matching candidates by specificity
-					std::sort(matching_candidates.begin(), matching_candidates.end(), [](auto & a, auto & b) {
-						return a.second > b.second;
-					});
+			return { MathObjType(it->second->value_type().type, it->second->is_const()) };
+		}
+	}
+	return MathObjType(MOT::MO_NONE);
+}
 
-					// Check if there's a unique maximum specificity
-					if (matching_candidates.size() > 1 && matching_candidates[0].second == matching_candidates[1].second)
-					{
-						register_semantic_error(
-							"ambiguous call to operator `" + op->op_info->name + '`',
-							"",
-							op.get()
-						);
-						return MathObjType(MOT::MO_NONE);
-					}
+SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze_expression(NodeIndex expression_index)
+{
+	size_t base = expression_stack.size();
+	expression_stack.push_back({ expression_index, false });
 
-					// Get the most specific candidate
-					auto & candidate = matching_candidates[0];
-					op->op_func = candidate.first;
+	// Operands are analyzed from left to right, each operator after its operands
+	while (expression_stack.size() > base)
+	{
+		ExpressionFrame frame = expression_stack.back();
+		expression_stack.pop_back();
+		ASTNode * node = &ast.node(frame.node);
 
-					// Check if the operator doesn't accept a constant argument
-					if (!candidate.first->arg_types.second.is_const && right_info.type.is_const)
-					{
-						register_semantic_error(
-							"operator `" + op->op_info->name + "` expects a non-constant argument",
-							"",
-							expr->right.get()
-						);
-						break;
-					}
-					else if (!candidate.first->arg_types.first.is_const && left_info.type.is_const)
-					{
-						register_semantic_error(
-							"operator `" + op->op_info->name + "` expects a non-constant argument",
-							"",
-							expr->left.get()
-						);
-						break;
-					}
+		if (frame.operands_analyzed)
+		{
+			if (node->n_type == NodeType::N_EXPR)
+			{
+				AnalysisResult right_info = operand_results.back();
+				operand_results.pop_back();
+				AnalysisResult left_info = operand_results.back();
+				operand_results.pop_back();
+				operand_results.push_back(analyze_binary(static_cast<ExpressionNode *>(node), left_info, right_info));
+			}
+			else
+			{
+				AnalysisResult operand_info = operand_results.back();
+				operand_results.pop_back();
+				operand_results.push_back(analyze_unary(static_cast<OperandNode *>(node), operand_info));
+			}
+			continue;
+		}
 
-					if (op->op_info->name == "=" && !can_convert(right_info.type, left_info.type))
-					{
-						register_semantic_error(
-							"cannot implicitly convert `" + mathobjtype_to_string(right_info.type.type) + "` to `" + mathobjtype_to_string(left_info.type.type) + "`",
-							"",
-							expr->right.get()
-						);
-						break;
-					}
+		if (panic_mode)
+		{
+			operand_results.push_back(MathObjType(MOT::MO_NONE));
+			continue;
+		}
 
-					return candidate.first->return_type;
-				}
+		if (node->n_type == NodeType::N_EXPR)
+		{
+			auto * expr = static_cast<ExpressionNode *>(node);
 
-				// No matching operator found
+			// Check if the lhs is not a variable
+			if (ast.get<OperatorNode>(expr->op).op_info->name == "=" && ast.node(expr->left).n_type != NodeType::N_IDENTIFIER)
+			{
 				register_semantic_error(
-					"no binary operator `" + op->op_info->name + "` matches these operand types",
-					'`' + mathobjtype_to_string(left_info.type.type) + "`, `" + mathobjtype_to_string(right_info.type.type) + '`',
-					op.get()
+					"left-hand side of assignment must be a modifiable lvalue",
+					"",
+					&ast.node(expr->left)
 				);
+				operand_results.push_back(MathObjType(MOT::MO_NONE));
+				continue;
 			}
-			break;
+
+			expression_stack.push_back({ frame.node, true });
+			expression_stack.push_back({ expr->right, false });
+			expression_stack.push_back({ expr->left, false });
 		}
-		case NodeType::N_OPERAND:
+		else if (node->n_type == NodeType::N_OPERAND)
 		{
-			auto * operand = static_cast<OperandNode *>(node);
-			AnalysisResult operand_info = analyze(operand->primary.get());
+			expression_stack.push_back({ frame.node, true });
+			expression_stack.push_back({ static_cast<OperandNode *>(node)->primary, false });
+		}
+		else
+			operand_results.push_back(analyze(frame.node));
+	}
 
-			auto & op = operand->op;
-			if (!op)
-				return operand_info.type;
-			
-			auto candidates = operator_table->get_implementations(op->op_info->name, true);
-			if (candidates.first != candidates.second)
-			{
-				// Iterate over the candidate operators and check if any of them match the operand type
-				for (auto & it = candidates.first; it != candidates.second; ++it)
-				{
-					auto & op_func = it->second;
-					auto arg_type = op_func->arg_types.first;
-					if (can_convert(operand_info.type, arg_type))
-					{
-						// Check if the operator doesn't accept a constant argument
-						if (!op_func->arg_types.first.is_const && operand_info.type.is_const)
-						{
-							register_semantic_error(
-								"operator `" + op->op_info->name + "` expects a non-constant argument",
-								"",
-								operand->primary.get()
-							);
-							break;
-						}
+	AnalysisResult result = operand_results.back();
+	operand_results.pop_back();
+	return result;
+}
 
-						op->op_func = op_func;
-						return op_func->return_type;
-					}
-				}
-				// No matching operator found
-			}
+SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze_binary(ExpressionNode * expr, AnalysisResult left_info, AnalysisResult right_info)
+{
+	auto * op = &ast.get<OperatorNode>(expr->op);
 
+	// Look up the most specific implementation for the operand types
+	const OperatorDispatch & dispatch = operator_table->resolve_binary(*op->op_info, left_info.type, right_info.type);
+	if (dispatch.status == DispatchStatus::D_AMBIGUOUS)
+	{
+		register_semantic_error(
+			"ambiguous call to operator `" + op->op_info->name + '`',
+			"",
+			op
+		);
+		return MathObjType(MOT::MO_NONE);
+	}
+
+	if (dispatch.status == DispatchStatus::D_MATCH)
+	{
+		const OperatorFunction * candidate = dispatch.function;
+		op->op_func = candidate;
+
+		// The target of an assignment is checked as an identifier
+		if (!candidate->is_pure && op->op_info->name != "=")
+			mark_impure();
+
+		// Check if the operator doesn't accept a constant argument
+		if (!candidate->arg_types.second.is_const && right_info.type.is_const)
+		{
 			register_semantic_error(
-				"no unary operator `" + op->op_info->name + "` matches this operand type",
-				'`' + mathobjtype_to_string(operand_info.type.type) + '`',
-				op.get()
+				"operator `" + op->op_info->name + "` expects a non-constant argument",
+				"",
+				&ast.node(expr->right)
 			);
-			break;
+			return MathObjType(MOT::MO_NONE);
 		}
-		case NodeType::N_LITERAL:
+		else if (!candidate->arg_types.first.is_const && left_info.type.is_const)
 		{
-			auto * literal = static_cast<LiteralNode *>(node);
-			return literal->type;
+			register_semantic_error(
+				"operator `" + op->op_info->name + "` expects a non-constant argument",
+				"",
+				&ast.node(expr->left)
+			);
+			return MathObjType(MOT::MO_NONE);
 		}
-		case NodeType::N_IDENTIFIER:
+
+		if (op->op_info->name == "=" && !can_convert(right_info.type, left_info.type))
 		{
-			auto * identifier = static_cast<IdentifierNode *>(node);
-			auto it = scope->find_variable(identifier->name);
-			if (it == scope->variables.end())
-			{
-				register_semantic_error(
-					"variable `" + std::string(identifier->name) + "` is not defined in this scope",
-					"",
-					identifier
-				);
-				break;
-			}
-			return { MathObjType(it->second->value_type().type, it->second->is_const()) };
+			register_semantic_error(
+				"cannot implicitly convert `" + mathobjtype_to_string(right_info.type.type) + "` to `" + mathobjtype_to_string(left_info.type.type) + "`",
+				"",
+				&ast.node(expr->right)
+			);
+			return MathObjType(MOT::MO_NONE);
 		}
+
+		return candidate->return_type;
+	}
+
+	if (dispatch.status == DispatchStatus::D_NO_MATCH)
+	{
+		// No matching operator found
+		register_semantic_error(
+			"no binary operator `" + op->op_info->name + "` matches these operand types",
+			'`' + mathobjtype_to_string(left_info.type.type) + "`, `" + mathobjtype_to_string(right_info.type.type) + '`',
+			op
+		);
 	}
 	return MathObjType(MOT::MO_NONE);
 }
 
+SemanticAnalyzer::AnalysisResult SemanticAnalyzer::analyze_unary(OperandNode * operand, AnalysisResult operand_info)
+{
+	if (operand->op == NO_NODE)
+		return operand_info.type;
+	auto * op = &ast.get<OperatorNode>(operand->op);
+	
+	// Look up the first implementation which accepts the operand type
+	const OperatorDispatch & dispatch = operator_table->resolve_unary(*op->op_info, operand_info.type);
+	if (dispatch.status == DispatchStatus::D_MATCH)
+	{
+		const OperatorFunction * op_func = dispatch.function;
+		// Check if the operator doesn't accept a constant argument
+		if (!op_func->arg_types.first.is_const && operand_info.type.is_const)
+		{
+			register_semantic_error(
+				"operator `" + op->op_info->name + "` expects a non-constant argument",
+				"",
+				&ast.node(operand->primary)
+			);
+			return MathObjType(MOT::MO_NONE);
+		}
+
+		op->op_func = op_func;
+		if (!op_func->is_pure)
+			mark_impure();
+		return op_func->return_type;
+	}
+
+	// No matching operator found
+	register_semantic_error(
+		"no unary operator `" + op->op_info->name + "` matches this operand type",
+		'`' + mathobjtype_to_string(operand_info.type.type) + '`',
+		op
+	);
+	return MathObjType(MOT::MO_NONE);
+}
+
 bool SemanticAnalyzer::in_function(void) const
 {
 	return context_stack.top().first == ContextType::C_RETURNING_FUNCTION || context_stack.top().first == ContextType::C_NONRETURNING_FUNCTION;
 }
 
+void SemanticAnalyzer::mark_impure(void)
+{
+	if (!in_function())
+		return;
+
+	auto * func_decl = static_cast<const FunctionDeclarationNode *>(context_stack.top().second);
+	func_decl->function->is_pure = false;
+}
+
+bool SemanticAnalyzer::is_function_local(SymbolId name) const
+{
+	// Look through the scopes up to the scope of the innermost function
+	for (auto current = scope; current; current = current->parent)
+	{
+		if (current->variables.find(name) != current->variables.end())
+			return true;
+		if (current->is_function_scope)
+			break;
+	}
+	return false;
+}
+
 void SemanticAnalyzer::register_semantic_error(std::string message, std::string additional_info, const ASTNode * node)
 {
 	if (panic_mode)
@@ -600,9 +615,7 @@ void SemanticAnalyzer::register_semantic_error(std::string message, std::string
 	std::unique_ptr<Error> err { new SemanticError(
 		message,
 		additional_info,
-		node->line,
-		node->column,
-		node->start_position,
+		node->location,
 		node->end_position - node->start_position
 	)};
 	ErrorHandler::push_error(err);
@@ -1,12 +1,20 @@
 #include "function.h"
 
-std::pair<FuncImplementations::const_iterator, FuncImplementations::const_iterator> FunctionTable::get_implementations(std::string_view name) const
+const FuncImplementations * FunctionTable::get_implementations(SymbolId name) const
 {
-	std::string s_name(name);
-	return functions.equal_range(s_name);
+	auto it = functions.find(name);
+	return it != functions.end() ? &it->second : nullptr;
 }
 
-void FunctionTable::register_function(std::string name, std::shared_ptr<Function> func)
+Function * FunctionTable::find_function(SymbolId signature) const
 {
-	functions.insert({ name, func });
+	auto it = signatures.find(signature);
+	return it != signatures.end() ? it->second : nullptr;
+}
+
+void FunctionTable::register_function(SymbolId name, std::shared_ptr<Function> func)
+{
+	signatures[func->signature] = func.get();
+	functions[name].push_back(std::move(func));
+	declarations.fetch_add(1, std::memory_order_relaxed);
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <bit>
+
+#include "memo.h"
+
+bool MemoTable::make_key(std::vector<std::shared_ptr<MathObj>> & arguments, Key & key)
+{
+	key.clear();
+	key.reserve(arguments.size());
+	for (auto & argument : arguments)
+	{
+		auto value = get_value(argument);
+		if (!value)
+			return false;
+
+		switch (value->type().type)
+		{
+			case MOT::MO_INTEGER:
+				key.emplace_back(MOT::MO_INTEGER, (uint64_t)value->as<Integer>()->value());
+				break;
+			case MOT::MO_REAL:
+				// Bit pattern, so that 0.0 and -0.0 are different arguments
+				key.emplace_back(MOT::MO_REAL, std::bit_cast<uint64_t>(value->as<Real>()->value()));
+				break;
+
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<MathObj> MemoTable::find(const Key & key)
+{
+	auto it = index.find(key);
+	if (it == index.end())
+		return nullptr;
+
+	// Mark the entry as the most recently used
+	entries.splice(entries.begin(), entries, it->second);
+	return it->second->second;
+}
+
+void MemoTable::insert(Key key, std::shared_ptr<MathObj> result)
+{
+	auto it = index.find(key);
+	if (it != index.end())
+	{
+		it->second->second = std::move(result);
+		entries.splice(entries.begin(), entries, it->second);
+		return;
+	}
+
+	if (entries.size() >= capacity)
+	{
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+
+	entries.emplace_front(key, std::move(result));
+	index.emplace(std::move(key), entries.begin());
+}
+
+size_t MemoTable::KeyHash::operator()(const Key & key) const
+{
+	size_t hash = key.size();
+	for (auto & [type, bits] : key)
+	{
+		hash ^= std::hash<uint64_t>()(bits) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		hash ^= (size_t)type;
+	}
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include <stdexcept>
+
+#include "ir.h"
+
+bool IRInstruction::has_result(void) const
+{
+	switch (op)
+	{
+		case IROpCode::I_CONST:
+		case IROpCode::I_LOAD_VAR:
+		case IROpCode::I_VAR_REF:
+		case IROpCode::I_ASSIGN:
+		case IROpCode::I_UNARY:
+		case IROpCode::I_BINARY:
+		case IROpCode::I_CALL:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool IRInstruction::has_side_effects(void) const
+{
+	switch (op)
+	{
+		case IROpCode::I_CONST:
+		case IROpCode::I_LOAD_VAR:
+		case IROpCode::I_VAR_REF:
+			return false;
+
+		case IROpCode::I_UNARY:
+		case IROpCode::I_BINARY:
+			return !op_func || !op_func->is_pure;
+
+		default:
+			return true;
+	}
+}
+
+bool IRInstruction::can_trap(void) const
+{
+	return (op == IROpCode::I_UNARY || op == IROpCode::I_BINARY) && op_func && op_func->can_trap;
+}
+
+bool IRInstruction::is_rematerializable(void) const
+{
+	return op == IROpCode::I_CONST || op == IROpCode::I_LOAD_VAR || op == IROpCode::I_VAR_REF;
+}
+
+bool IRInstruction::is_terminator(void) const
+{
+	return op == IROpCode::I_RETURN || op == IROpCode::I_RETURN_VALUE || op == IROpCode::I_LEAVE_FUNCTION;
+}
+
+IRValue IRFunction::append(IRInstruction instruction)
+{
+	if (instruction.has_result())
+		instruction.result = next_value++;
+	instructions.push_back(std::move(instruction));
+	return instructions.back().result;
+}
+
+std::vector<size_t> IRFunction::use_counts(void) const
+{
+	std::vector<size_t> uses(next_value, 0);
+	for (auto & instruction : instructions)
+		for (IRValue operand : instruction.operands)
+			uses[operand]++;
+	return uses;
+}
+
+std::vector<size_t> IRFunction::definitions(void) const
+{
+	std::vector<size_t> defs(next_value, SIZE_MAX);
+	for (size_t i = 0; i < instructions.size(); i++)
+		if (instructions[i].has_result())
+			defs[instructions[i].result] = i;
+	return defs;
+}
+
+void IRFunction::replace_all_uses(IRValue from, IRValue to)
+{
+	for (auto & instruction : instructions)
+		for (IRValue & operand : instruction.operands)
+			if (operand == from)
+				operand = to;
+}
+
+ConstantKey constant_key(const std::shared_ptr<MathObj> & constant)
+{
+	switch (constant->type().type)
+	{
+		case MOT::MO_INTEGER:
+			return ConstantKey::of(constant->as<Integer>()->value());
+		case MOT::MO_REAL:
+			return ConstantKey::of(constant->as<Real>()->value());
+
+		default:
+			// just in case of a bug
+			throw std::logic_error("invalid constant type in `constant_key()`");
+	}
+}
\ No newline at end of file
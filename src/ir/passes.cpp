@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "passes.h"
+
+bool ConstantFolding::run(IRFunction & function)
+{
+	bool changed = false;
+	auto defs = function.definitions();
+
+	for (auto & instruction : function.instructions)
+	{
+		if (instruction.op != IROpCode::I_UNARY && instruction.op != IROpCode::I_BINARY)
+			continue;
+
+		auto & op_func = instruction.op_func;
+		if (!op_func || !op_func->is_pure || op_func->type != OperatorType::O_BUILTIN)
+			continue;
+
+		// All the operands must be constants
+		std::vector<std::shared_ptr<MathObj>> args;
+		for (IRValue operand : instruction.operands)
+		{
+			auto & def = function.instructions[defs[operand]];
+			if (def.op != IROpCode::I_CONST)
+				break;
+			args.push_back(def.constant);
+		}
+		if (args.size() != instruction.operands.size())
+			continue;
+
+		std::shared_ptr<MathObj> result;
+		try
+		{
+			if (instruction.op == IROpCode::I_UNARY)
+			{
+				auto _ = std::shared_ptr<MathObj>(new None());
+				result = op_func->implementation(_, args[0]);
+			}
+			else
+			{
+				result = op_func->implementation(args[0], args[1]);
+			}
+		}
+		catch (const std::runtime_error &)
+		{
+			// e.g. an integer division by zero, reported when the program runs
+			continue;
+		}
+
+		// Keep the type found by the semantic analyzer
+		if (!result || result->type().type != instruction.type.type)
+			continue;
+		// Leave invalid operations (e.g. division by zero) to the runtime
+		if (!std::isfinite(result->as<Real>()->value()))
+			continue;
+
+		IRInstruction folded(IROpCode::I_CONST, MathObjType(instruction.type.type), instruction.node);
+		folded.result = instruction.result;
+		folded.constant = result;
+		folded.constant_key = constant_key(result);
+		instruction = std::move(folded);
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool StrengthReduction::run(IRFunction & function)
+{
+	bool changed = false;
+
+	// Looked up before the instructions are moved into the new list
+	std::vector<std::shared_ptr<MathObj>> constants(function.next_value);
+	for (auto & instruction : function.instructions)
+		if (instruction.op == IROpCode::I_CONST)
+			constants[instruction.result] = instruction.constant;
+
+	// The value that replaces each value (`x ^ 1` is replaced by x)
+	std::vector<IRValue> replacements(function.next_value);
+	for (IRValue value = 0; value < function.next_value; value++)
+		replacements[value] = value;
+
+	std::vector<IRInstruction> instructions;
+	instructions.reserve(function.instructions.size());
+	for (auto & instruction : function.instructions)
+	{
+		for (IRValue & operand : instruction.operands)
+			operand = replacements[operand];
+
+		if (instruction.op != IROpCode::I_BINARY || instruction.op_name != "^" || !constants[instruction.operands[1]]
+			|| !instruction.op_func || instruction.op_func->type != OperatorType::O_BUILTIN)
+		{
+			instructions.push_back(std::move(instruction));
+			continue;
+		}
+		IRValue base = instruction.operands[0];
+		auto & exponent = constants[instruction.operands[1]];
+
+		// `x ^ 0.5` is real whatever the type of x
+		auto sqrt = operator_table.find_implementation("sqrt", {MOT::MO_REAL, MOT::MO_NONE}, true);
+		if (exponent->type().type == MOT::MO_REAL && exponent->as<Real>()->value() == 0.5
+			&& instruction.type.type == MOT::MO_REAL && sqrt)
+		{
+			instruction.op = IROpCode::I_UNARY;
+			instruction.op_func = sqrt;
+			instruction.op_name = "sqrt";
+			instruction.operands = {base};
+			instructions.push_back(std::move(instruction));
+			changed = true;
+			continue;
+		}
+
+		// Only integer exponents: like `x ^ n`, `x * x` is an integer if and only if x is an integer
+		// at runtime, while `x ^ 2.0` is always real
+		long long n = exponent->type().type == MOT::MO_INTEGER ? exponent->as<Integer>()->value() : 0;
+		bool integer_base = instruction.op_func->arg_types.first.type == MOT::MO_INTEGER;
+		auto multiply = operator_table.find_implementation("*", instruction.op_func->arg_types);
+		if (n < 1 || n > (integer_base ? MAX_EXPONENT : MAX_REAL_EXPONENT) || !multiply)
+		{
+			instructions.push_back(std::move(instruction));
+			continue;
+		}
+		changed = true;
+
+		if (n == 1)
+		{
+			replacements[instruction.result] = base;
+			continue;
+		}
+
+		auto emit_multiply = [&](IRValue lhs, IRValue rhs) {
+			IRInstruction product(IROpCode::I_BINARY, instruction.type, instruction.node);
+			product.op_func = multiply;
+			product.op_name = "*";
+			product.operands = {lhs, rhs};
+			product.result = function.next_value++;
+			instructions.push_back(std::move(product));
+			return instructions.back().result;
+		};
+
+		// Exponentiation by squaring: x, x^2, x^4... is multiplied into the result for each bit of n
+		IRValue result = IR_NO_VALUE;
+		IRValue power = base;
+		for (long long remaining = n;; remaining >>= 1)
+		{
+			if (remaining & 1)
+				result = result == IR_NO_VALUE ? power : emit_multiply(result, power);
+			if (remaining == 1)
+				break;
+			power = emit_multiply(power, power);
+		}
+		// The last multiplication computes the final result, so it takes over the original value
+		instructions.back().result = instruction.result;
+	}
+
+	function.instructions = std::move(instructions);
+	return changed;
+}
+
+// Structural key of a pure expression
+struct ExpressionKey
+{
+	IROpCode op;
+	const OperatorFunction * op_func;
+	ConstantKey constant_key;
+	uint8_t variable;
+	uint32_t version; // Number of assignments to `variable` before the load
+	std::vector<IRValue> operands;
+
+	bool operator==(const ExpressionKey & other) const = default;
+};
+
+struct ExpressionKeyHash
+{
+	size_t operator()(const ExpressionKey & key) const
+	{
+		size_t hash = std::hash<int>()((int)key.op);
+		auto combine = [&hash](size_t value) {
+			hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		};
+
+		combine(std::hash<const OperatorFunction *>()(key.op_func));
+		combine(ConstantKeyHash()(key.constant_key));
+		combine(key.variable);
+		combine(key.version);
+		for (IRValue operand : key.operands)
+			combine(operand);
+		return hash;
+	}
+};
+
+bool CommonSubexpressionElimination::run(IRFunction & function)
+{
+	bool changed = false;
+	auto defs = function.definitions();
+
+	// The value that replaces each value (itself if it is the first of its kind)
+	std::vector<IRValue> leaders(function.next_value);
+	for (IRValue value = 0; value < function.next_value; value++)
+		leaders[value] = value;
+
+	std::unordered_map<ExpressionKey, IRValue, ExpressionKeyHash> available;
+	std::unordered_map<uint8_t, uint32_t> versions;
+
+	for (auto & instruction : function.instructions)
+	{
+		for (IRValue & operand : instruction.operands)
+		{
+			if (leaders[operand] != operand)
+			{
+				operand = leaders[operand];
+				changed = true;
+			}
+		}
+
+		switch (instruction.op)
+		{
+			case IROpCode::I_ASSIGN:
+				versions[function.instructions[defs[instruction.operands[0]]].index]++;
+				continue;
+			case IROpCode::I_SET_VAR:
+			case IROpCode::I_SET_PARAM:
+				versions[instruction.index]++;
+				continue;
+			case IROpCode::I_CALL:
+				// The function may assign any variable outside of it
+				std::erase_if(available, [](auto & entry) {
+					return entry.first.op == IROpCode::I_LOAD_VAR;
+				});
+				continue;
+
+			default:
+				break;
+		}
+
+		if (!instruction.has_result() || instruction.has_side_effects() || instruction.op == IROpCode::I_VAR_REF)
+			continue;
+
+		ExpressionKey key {
+			instruction.op,
+			instruction.op_func.get(),
+			instruction.constant_key,
+			instruction.index,
+			instruction.op == IROpCode::I_LOAD_VAR ? versions[instruction.index] : 0,
+			instruction.operands
+		};
+
+		auto [it, inserted] = available.try_emplace(std::move(key), instruction.result);
+		if (!inserted)
+			leaders[instruction.result] = it->second;
+	}
+
+	return changed;
+}
+
+bool DeadCodeElimination::run(IRFunction & function)
+{
+	auto & instructions = function.instructions;
+	size_t size = instructions.size();
+
+	// There are no branches, so nothing after a return can be reached
+	auto terminator = std::find_if(instructions.begin(), instructions.end(), [](auto & instruction) {
+		return instruction.is_terminator();
+	});
+	if (terminator != instructions.end())
+		instructions.erase(terminator + 1, instructions.end());
+
+	// Walk backwards so that the operands of a removed value are removed in the same pass
+	auto uses = function.use_counts();
+	std::vector<bool> dead(instructions.size(), false);
+	for (size_t i = instructions.size(); i-- > 0;)
+	{
+		auto & instruction = instructions[i];
+		if (!instruction.has_result() || instruction.has_side_effects() || instruction.can_trap() || uses[instruction.result] > 0)
+			continue;
+
+		dead[i] = true;
+		for (IRValue operand : instruction.operands)
+			uses[operand]--;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < instructions.size(); i++)
+	{
+		if (dead[i])
+			continue;
+		if (kept != i)
+			instructions[kept] = std::move(instructions[i]);
+		kept++;
+	}
+	instructions.erase(instructions.begin() + kept, instructions.end());
+
+	return size != instructions.size();
+}
\ No newline at end of file
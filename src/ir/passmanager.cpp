@@ -0,0 +1,34 @@
+#include "passmanager.h"
+#include "passes.h"
+
+void PassManager::add_pass(std::unique_ptr<Pass> pass)
+{
+	passes.push_back(std::move(pass));
+}
+
+void PassManager::run(IRFunction & function)
+{
+	for (int i = 0; i < MAX_ITERATIONS; i++)
+	{
+		bool changed = false;
+		for (auto & pass : passes)
+			changed |= pass->run(function);
+
+		if (!changed)
+			break;
+	}
+}
+
+PassManager PassManager::for_level(int level, const OperatorTable & operator_table)
+{
+	PassManager manager;
+	if (level >= 1)
+	{
+		manager.add_pass(std::make_unique<ConstantFolding>());
+		manager.add_pass(std::make_unique<StrengthReduction>(operator_table));
+		if (level >= 2)
+			manager.add_pass(std::make_unique<CommonSubexpressionElimination>());
+		manager.add_pass(std::make_unique<DeadCodeElimination>());
+	}
+	return manager;
+}
\ No newline at end of file
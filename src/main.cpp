@@ -1,12 +1,21 @@
 #include <iostream>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <cstring>
 #include <string>
 #include <string_view>
+#include <chrono>
+#include <thread>
 
 #include "vm.h"
 #include "globals.h"
+#include "scan.h"
+#include "semanalyzer.h"
+#include "error.h"
+#include "mappedfile.h"
+#include "image.h"
+#include "cache.h"
 
 #include "mathlangconfig.h"
 
@@ -21,9 +30,22 @@ void open_file(std::string path);
 
 bool read_arguments(int argc, const char ** argv);
 size_t find_dot(std::string_view path);
-void check_file_extension(std::string_view path);
+bool check_file_extension(std::string_view path);
 std::string_view extract_file_name(std::string_view path);
-void tabs_to_spaces(std::string & source);
+std::string build_identity(void);
+std::string cache_salt(void);
+bool run_cached(std::string_view source);
+
+// Images the prelude is restored from: the mapping of its snapshot in the cache, or a snapshot
+// made in memory
+struct Prelude
+{
+	std::unique_ptr<MappedFile> file;
+	std::string image;
+};
+void load_prelude(VM & vm, Prelude & prelude);
+void benchmark_lexer(std::string_view source);
+void benchmark_analyzer(std::string_view source);
 
 void repl(void);
 
@@ -69,7 +91,11 @@ void repl(void)
 	print_version(); // print version info
 	std::cout << "Type `quit` to terminate the interpreter\n";
 
-	VM vm;
+	Prelude prelude; // Outlives the VM
+	VM vm(true);
+	if (!config::prelude.empty())
+		load_prelude(vm, prelude);
+
 	// loop continuously to read user input
 	while (true)
 	{
@@ -86,13 +112,14 @@ void repl(void)
 			// enable debug output
 			config::print_lexer_output = true;
 			config::print_parser_output = true;
+			config::print_ir_output = true;
 			config::print_compiler_output = true;
 			std::cout << "debug mode enabled\n";
 			continue;
 		}
 
 		vm.interpret_source(line);
-		std::cout << std::endl;
+		std::cout << '\n'; // Flushed before the next line is read (`std::cin` is tied to `std::cout`)
 	}
 }
 
@@ -132,14 +159,107 @@ bool read_arguments(int argc, const char **argv)
 				return false; // Exit early
 			}
 
+			// Handle -c flag
+			if (IS_SHORT_FLAG('c', argv[i]))
+			{
+				config::compile_only = true;
+				continue;
+			}
+
 			// Handle -l flag
 			if (IS_SHORT_FLAG('l', argv[i]))
 			{
 				config::print_lexer_output = true;
 				config::print_parser_output = true;
+				config::print_ir_output = true;
 				config::print_compiler_output = true;
 				continue;
 			}
+
+			// Handle -O0/-O1/-O2 flags
+			if (std::strlen(argv[i]) == 3 && argv[i][1] == 'O')
+			{
+				if (argv[i][2] < '0' || argv[i][2] > '2')
+					throw std::invalid_argument("unknown optimization level `" + std::string(argv[i]) + '`');
+
+				config::optimization_level = argv[i][2] - '0';
+				continue;
+			}
+
+			// Handle --memoize flag
+			if (IS_LONG_FLAG("memoize", argv[i]))
+			{
+				config::memoize = true;
+				continue;
+			}
+
+			// Handle --bench-lexer flag
+			if (IS_LONG_FLAG("bench-lexer", argv[i]))
+			{
+				config::benchmark_lexer = true;
+				continue;
+			}
+
+			// Handle --bench-analyzer flag
+			if (IS_LONG_FLAG("bench-analyzer", argv[i]))
+			{
+				config::benchmark_analyzer = true;
+				continue;
+			}
+
+			// Handle --no-cache flag
+			if (IS_LONG_FLAG("no-cache", argv[i]))
+			{
+				config::use_cache = false;
+				continue;
+			}
+
+			// Handle --stream flag
+			if (IS_LONG_FLAG("stream", argv[i]))
+			{
+				config::stream = true;
+				continue;
+			}
+
+			// Handle --pipeline flag
+			if (IS_LONG_FLAG("pipeline", argv[i]))
+			{
+				config::stream = config::pipeline = true;
+				continue;
+			}
+
+			// Handle --lex-threads flag
+			if (IS_LONG_FLAG("lex-threads", argv[i]))
+			{
+				if (i + 1 > argc - 1) // Check that a number was specified
+					throw std::invalid_argument("no number of threads was specified");
+
+				std::string_view count = argv[++i];
+				if (count.empty() || count.length() > 3 || count.find_first_not_of("0123456789") != std::string_view::npos)
+					throw std::invalid_argument("invalid number of threads `" + std::string(count) + '`');
+
+				config::lex_threads = std::stoul(std::string(count));
+				if (config::lex_threads == 0)
+					config::lex_threads = std::max(std::thread::hardware_concurrency(), 1u);
+				continue;
+			}
+
+			// Handle --prelude flag
+			if (IS_LONG_FLAG("prelude", argv[i]))
+			{
+				if (i + 1 > argc - 1) // Check that a file was specified
+					throw std::invalid_argument("no prelude was specified");
+
+				config::prelude = argv[++i];
+				continue;
+			}
+
+			// Handle --dump-ir flag
+			if (IS_LONG_FLAG("dump-ir", argv[i]))
+			{
+				config::print_ir_output = true;
+				continue;
+			}
 		}
 	}
 
@@ -148,24 +268,230 @@ bool read_arguments(int argc, const char **argv)
 
 void open_file(std::string path)
 {
-	check_file_extension(path);
+	bool is_image = check_file_extension(path);
 	file_name = extract_file_name(path);
 
-	std::ifstream file { path };
+	// The source is lexed straight from the mapping (tabs are measured by the lexer)
+	MappedFile file { path };
+	std::string_view source = file.view();
 
-	if (!file.is_open())
-		throw std::ios_base::failure("unable to open file `" + path + '`');
+	if (is_image)
+	{
+		if (config::compile_only)
+			throw std::invalid_argument("`" + path + "` is compiled already");
+		if (!config::prelude.empty())
+			throw std::invalid_argument("a compiled program cannot be run with a prelude");
+
+		// The bytecode is run from the mapping
+		VM vm;
+		vm.interpret_image(source);
+		return;
+	}
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
+	if (config::benchmark_lexer)
+	{
+		benchmark_lexer(source);
+		return;
+	}
+	if (config::benchmark_analyzer)
+	{
+		benchmark_analyzer(source);
+		return;
+	}
 
-	std::string source = buffer.str();
-	tabs_to_spaces(source);
+	// A compiled program would miss the code of the prelude which initializes its variables
+	if (config::compile_only && !config::prelude.empty())
+		throw std::invalid_argument("a program cannot be compiled with a prelude");
+	if (config::compile_only && config::stream)
+		throw std::invalid_argument("a program cannot be compiled with --stream");
+
+	// Debug output needs the front end to run (and the programs in the cache have no prelude,
+	// and are compiled as a whole)
+	bool debug_output = config::print_lexer_output || config::print_parser_output ||
+		config::print_ir_output || config::print_compiler_output;
+	if (config::use_cache && !config::compile_only && !debug_output && config::prelude.empty() && !config::stream
+		&& run_cached(source))
+		return;
+
+	Prelude prelude; // Outlives the VM
+	VM vm(config::stream); // Streamed statements are released once they have run, like REPL inputs
+	if (!config::prelude.empty())
+		load_prelude(vm, prelude);
+	if (config::stream)
+	{
+		// Debug output is printed in order by a single thread
+		if (config::pipeline && !debug_output)
+			vm.interpret_pipelined(source);
+		else
+			vm.interpret_stream(source);
+		return;
+	}
+	if (!vm.interpret_source(source) || !config::compile_only)
+		return;
+
+	std::string image_path = path + 'c'; // `.mthl` -> `.mthlc`
+	std::ofstream image { image_path, std::ios::binary };
+	vm.save_image(image);
+	if (!image)
+		throw std::ios_base::failure("unable to write file `" + image_path + '`');
+}
+
+bool run_cached(std::string_view source)
+{
+	std::filesystem::path directory = ProgramCache::default_directory();
+	if (directory.empty())
+		return false;
+
+	ProgramCache cache(directory);
+	std::filesystem::path entry = cache.entry(source, cache_salt());
+
+	// Warm run: the front end is skipped (an invalid entry, or one whose bytecode does not pass
+	// the verification of `load_image()`, is dropped and compiled again)
+	std::error_code error;
+	if (std::filesystem::exists(entry, error))
+	{
+		std::unique_ptr<MappedFile> file;
+		VM vm;
+		try
+		{
+			file = std::make_unique<MappedFile>(entry.string());
+			vm.load_image(file->view());
+		}
+		catch (const std::exception &)
+		{
+			cache.remove(entry);
+			file = nullptr;
+		}
+
+		if (file)
+		{
+			cache.touch(entry);
+			vm.execute();
+			return true;
+		}
+	}
+
+	// Cold run: the program is compiled ahead of time and run from its image, like a warm run.
+	// Programs that cannot be compiled ahead of time are run from the source (which reports the errors)
+	std::string image;
+	{
+		VM vm;
+		if (!vm.compile_image(source, image))
+			return false;
+	}
+	cache.store(entry, image);
 
 	VM vm;
-	vm.interpret_source(source);
+	vm.interpret_image(image);
+	return true;
+}
+
+// Size and modification time of the interpreter: a rebuilt interpreter does not reuse the programs
+// compiled by the previous one, even if `CODEGEN_VERSION` was not bumped (empty if it is not found)
+std::string build_identity(void)
+{
+	std::error_code error;
+	std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+	if (error)
+		return "";
+
+	auto size = std::filesystem::file_size(executable, error);
+	auto time = std::filesystem::last_write_time(executable, error);
+	if (error)
+		return "";
+	return std::to_string(size) + ' ' + std::to_string(time.time_since_epoch().count());
+}
+
+std::string cache_salt(void)
+{
+	// Everything the bytecode depends on besides the source
+	return std::to_string(MathLang_VERSION_MAJOR) + '.' + std::to_string(MathLang_VERSION_MINOR)
+		+ " image " + std::to_string(IMAGE_VERSION)
+		+ " codegen " + std::to_string(CODEGEN_VERSION)
+		+ " build " + build_identity()
+		+ " -O" + std::to_string(config::optimization_level);
+}
+
+void load_prelude(VM & vm, Prelude & prelude)
+{
+	const std::string & path = config::prelude;
+	bool is_image = check_file_extension(path);
+	std::string_view program_name = file_name;
+	file_name = extract_file_name(path); // Errors of the prelude are reported against it
+
+	// The prelude is restored from a snapshot of the state it leaves (its variables and its
+	// output), which is kept in the cache, so it only runs when it changes
+	prelude.file = std::make_unique<MappedFile>(path);
+	std::string_view contents = prelude.file->view();
+	std::filesystem::path directory = config::use_cache ? ProgramCache::default_directory() : "";
+	ProgramCache cache(directory);
+	std::filesystem::path entry;
+	std::error_code error;
+	if (!directory.empty())
+	{
+		entry = cache.entry(contents, cache_salt() + " snapshot");
+		std::unique_ptr<MappedFile> snapshot;
+		if (std::filesystem::exists(entry, error))
+		{
+			try
+			{
+				snapshot = std::make_unique<MappedFile>(entry.string());
+				vm.load_image(snapshot->view());
+			}
+			catch (const std::exception &)
+			{
+				cache.remove(entry);
+				snapshot = nullptr;
+			}
+		}
+
+		if (snapshot)
+		{
+			cache.touch(entry);
+			prelude.file = std::move(snapshot);
+			vm.execute();
+			file_name = program_name;
+			return;
+		}
+	}
+
+	// The prelude is compiled (unless it is compiled already) and run on another VM, whose state
+	// is saved. The language has no input, so the prelude leaves the same state on every run
+	std::string image;
+	if (!is_image)
+	{
+		VM compiler;
+		if (!compiler.compile_image(contents, image, false))
+			throw std::runtime_error("the prelude `" + path + "` has errors");
+	}
+
+	std::ostringstream printed, snapshot;
+	std::exception_ptr failure;
+	{
+		VM runner(false, printed);
+		try
+		{
+			runner.interpret_image(is_image ? contents : image);
+			runner.save_snapshot(snapshot, printed.str());
+		}
+		catch (...)
+		{
+			failure = std::current_exception();
+		}
+	}
+	if (failure)
+	{
+		// Keep the output before the error
+		std::cout << printed.str();
+		std::rethrow_exception(failure);
+	}
 
-	file.close();
+	prelude.image = std::move(snapshot).str();
+	if (!directory.empty())
+		cache.store(entry, prelude.image);
+	vm.load_image(prelude.image);
+	vm.execute();
+	file_name = program_name;
 }
 
 std::string_view extract_file_name(std::string_view path)
@@ -180,7 +506,7 @@ std::string_view extract_file_name(std::string_view path)
 	return path.substr(i + 1);
 }
 
-void check_file_extension(std::string_view path)
+bool check_file_extension(std::string_view path)
 {
 	size_t extension_index = find_dot(path);
 	// if no '.' was found, throw an error
@@ -194,9 +520,14 @@ void check_file_extension(std::string_view path)
 	if (extension.length() == 1)
 		throw std::invalid_argument("invalid file format");
 
+	// compiled programs are recognized too
+	if (extension == IMAGE_EXTENSION)
+		return true;
+
 	// check if the extension matches the expected one
 	if (extension.length() != EXTENSION_LENGTH || extension != EXTENSION)
 		throw std::invalid_argument("file format not recognized");
+	return false;
 }
 
 size_t find_dot(std::string_view path)
@@ -208,16 +539,67 @@ size_t find_dot(std::string_view path)
 	return std::string::npos;
 }
 
-void tabs_to_spaces(std::string & source)
+void benchmark_lexer(std::string_view source)
 {
-	size_t tab_index = source.find('\t');
-	while (tab_index != std::string::npos)
+	using clock = std::chrono::steady_clock;
+
+	// Tokenize the source repeatedly for at least a second
+	size_t runs = 0, tokens = 0;
+	std::chrono::duration<double> elapsed {};
+	auto symbols = std::make_shared<SymbolTable>();
+	auto start = clock::now();
+	do
 	{
-		source.replace(tab_index, 1, "    ");
-		tab_index = source.find('\t');
-	}
+		Lexer lexer(source, symbols);
+		tokens = lexer.tokenize_parallel(config::lex_threads).size();
+		runs++;
+		elapsed = clock::now() - start;
+	} while (elapsed.count() < 1.0);
+
+	double megabytes = (double)source.length() * runs / 1e6;
+	std::cout << "lexer (" << scan_instruction_set() << "): "
+			  << source.length() << " bytes, " << tokens << " tokens, "
+			  << runs << " runs in " << elapsed.count() << " s, "
+			  << megabytes / elapsed.count() << " MB/s\n";
 }
 
+void benchmark_analyzer(std::string_view source)
+{
+	using clock = std::chrono::steady_clock;
+
+	// Parse and analyze the source repeatedly for at least a second (only the analysis is
+	// timed, which is where operators and function calls are resolved)
+	size_t runs = 0;
+	std::chrono::duration<double> elapsed {}, analysis {};
+	Session session;
+	auto start = clock::now();
+	do
+	{
+		Lexer lexer(source, session.symbols);
+		Parser parser(lexer, session.operator_table);
+		parser.parse_source();
+
+		auto scope = std::make_shared<Scope>();
+		SemanticAnalyzer semantic_analyzer(parser.get_ast(), session.operator_table, session.symbols, scope);
+		auto analysis_start = clock::now();
+		semantic_analyzer.analyze_source();
+		analysis += clock::now() - analysis_start;
+
+		if (ErrorHandler::has_errors())
+		{
+			ErrorHandler::report_errors(source);
+			return;
+		}
+		runs++;
+		elapsed = clock::now() - start;
+	} while (elapsed.count() < 1.0);
+
+	double megabytes = (double)source.length() * runs / 1e6;
+	std::cout << "analyzer: "
+			  << source.length() << " bytes, "
+			  << runs << " runs, " << analysis.count() << " s of analysis, "
+			  << megabytes / analysis.count() << " MB/s\n";
+}
 
 void print_usage(void)
 {
@@ -237,6 +619,18 @@ void print_help(void)
     std::cout << "options:\n"
 			  << "    --help (or -h)\t: Display this help message\n"
     		  << "    --version (or -v)\t: Display interpreter version and additional information\n"
-			  << "    -f <file>\t\t: Read from a file. <file> must have the `.mthl` extension\n"
-			  << "    -l\t\t\t: Print the stream of tokens generated by the lexer\n";
+			  << "    -f <file>\t\t: Read from a file. <file> must have the `.mthl` extension (or `.mthlc` if compiled with -c)\n"
+			  << "    -c\t\t\t: Compile the file given with -f into a `.mthlc` program next to it instead of running it\n"
+			  << "    -l\t\t\t: Print the stream of tokens generated by the lexer\n"
+			  << "    -O<level>\t\t: Set the optimization level (0, 1 or 2; default is 1)\n"
+			  << "    --dump-ir\t\t: Print the optimized intermediate representation\n"
+			  << "    --memoize\t\t: Cache the results of pure functions\n"
+			  << "    --stream\t\t: Run the file a few statements at a time, in constant memory (it stops at the first error)\n"
+			  << "    --pipeline\t\t: Same as --stream, with the file scanned and parsed ahead on other threads\n"
+			  << "    --lex-threads <n>\t: Scan large files on <n> threads (0 for one per core; default is 1)\n"
+			  << "    --prelude <file>\t: Run <file> (`.mthl` or `.mthlc`) before the program or the REPL, restored from a cached\n"
+			  << "\t\t\t  snapshot of its state (both share the 255 constants, variables and functions of a program)\n"
+			  << "    --no-cache\t\t: Do not reuse or store compiled programs (kept in $MATHLANG_CACHE_DIR, or ~/.cache/mathlang)\n"
+			  << "    --bench-lexer\t: Measure the throughput of the lexer on the file given with -f\n"
+			  << "    --bench-analyzer\t: Measure the throughput of the semantic analyzer on the file given with -f\n";
 }
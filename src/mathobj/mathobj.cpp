@@ -0,0 +1,35 @@
+#include <charconv>
+#include <algorithm>
+
+#include "mathobj.h"
+
+char * format_integer(char * first, long long value)
+{ return std::to_chars(first, first + NUMBER_CHARS, value).ptr; }
+
+char * format_real(char * first, double value)
+{
+	// Without a format, `std::to_chars` gives the shortest round-trip text (Ryu), and it
+	// does not depend on the locale
+	char * last = std::to_chars(first, first + NUMBER_CHARS, value).ptr;
+
+	// Integral values are printed as `1.0`, not `1`
+	bool integral = std::all_of(first, last, [](char c) { return (c >= '0' && c <= '9') || c == '-'; });
+	if (integral)
+	{
+		*last++ = '.';
+		*last++ = '0';
+	}
+	return last;
+}
+
+std::string Real::to_string(void) const
+{
+	char buffer[NUMBER_CHARS];
+	return std::string(buffer, format_real(buffer, _value_));
+}
+
+std::string Integer::to_string(void) const
+{
+	char buffer[NUMBER_CHARS];
+	return std::string(buffer, format_integer(buffer, _int_value_));
+}
\ No newline at end of file
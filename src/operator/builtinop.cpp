@@ -1,16 +1,75 @@
-#include <iostream>
 #include <cmath>
+#include <stdexcept>
 
 #include "builtinop.h"
+#include "output.h"
+
+// Integers wrap around on overflow (two's complement) in every operator
+static long long wrapping_add(long long lhs, long long rhs)
+{
+	long long result;
+	__builtin_add_overflow(lhs, rhs, &result);
+	return result;
+}
+
+static long long wrapping_subtract(long long lhs, long long rhs)
+{
+	long long result;
+	__builtin_sub_overflow(lhs, rhs, &result);
+	return result;
+}
+
+static long long wrapping_multiply(long long lhs, long long rhs)
+{
+	long long result;
+	__builtin_mul_overflow(lhs, rhs, &result);
+	return result;
+}
+
+static long long integer_divide(long long dividend, long long divisor)
+{
+	if (divisor == 0)
+		throw std::runtime_error("division by zero");
+	// The only quotient that overflows
+	if (divisor == -1)
+		return wrapping_subtract(0, dividend);
+	return dividend / divisor;
+}
+
+long long integer_power(long long base, long long exponent)
+{
+	if (exponent < 0)
+	{
+		// Only 1 and -1 have an integer inverse
+		if (base == 0)
+			throw std::runtime_error("division by zero");
+		if (base != 1 && base != -1)
+			throw std::runtime_error("negative exponent of an integer");
+		return exponent % 2 == 0 ? 1 : base;
+	}
+
+	// Exponentiation by squaring (unsigned so that an overflow wraps around)
+	unsigned long long result = 1;
+	unsigned long long square = base;
+	while (exponent > 0)
+	{
+		if (exponent & 1)
+			result *= square;
+		exponent >>= 1;
+		if (exponent > 0)
+			square *= square;
+	}
+	return (long long)result;
+}
 
 // * Binary operators
 BuiltinOpFunc ml__add__real_real = [](std::shared_ptr<MathObj> & lhs, std::shared_ptr<MathObj> & rhs) -> std::shared_ptr<MathObj>
 {
 	auto lhs_value = std::static_pointer_cast<Real>(get_value(lhs));
 	auto rhs_value = std::static_pointer_cast<Real>(get_value(rhs));
-	if (lhs->type().type == MOT::MO_INTEGER && rhs->type().type == MOT::MO_INTEGER)
+	if (lhs_value->type().type == MOT::MO_INTEGER && rhs_value->type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(lhs_value->value() + rhs_value->value());
+		return std::make_shared<Integer>(wrapping_add(lhs_value->as<Integer>()->value(), rhs_value->as<Integer>()->value()));
 	}
 	else
 	{
@@ -22,9 +81,9 @@ BuiltinOpFunc ml__subtract__real_real = [](std::shared_ptr<MathObj> & lhs, std::
 {
 	auto lhs_value = std::static_pointer_cast<Real>(get_value(lhs));
 	auto rhs_value = std::static_pointer_cast<Real>(get_value(rhs));
-	if (lhs->type().type == MOT::MO_INTEGER && rhs->type().type == MOT::MO_INTEGER)
+	if (lhs_value->type().type == MOT::MO_INTEGER && rhs_value->type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(lhs_value->value() - rhs_value->value());
+		return std::make_shared<Integer>(wrapping_subtract(lhs_value->as<Integer>()->value(), rhs_value->as<Integer>()->value()));
 	}
 	else
 	{
@@ -36,9 +95,9 @@ BuiltinOpFunc ml__multiply__real_real = [](std::shared_ptr<MathObj> & lhs, std::
 {
 	auto lhs_value = std::static_pointer_cast<Real>(get_value(lhs));
 	auto rhs_value = std::static_pointer_cast<Real>(get_value(rhs));
-	if (lhs->type().type == MOT::MO_INTEGER && rhs->type().type == MOT::MO_INTEGER)
+	if (lhs_value->type().type == MOT::MO_INTEGER && rhs_value->type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(lhs_value->value() * rhs_value->value());
+		return std::make_shared<Integer>(wrapping_multiply(lhs_value->as<Integer>()->value(), rhs_value->as<Integer>()->value()));
 	}
 	else
 	{
@@ -50,9 +109,9 @@ BuiltinOpFunc ml__divide__real_real = [](std::shared_ptr<MathObj> & lhs, std::sh
 {
 	auto lhs_value = std::static_pointer_cast<Real>(get_value(lhs));
 	auto rhs_value = std::static_pointer_cast<Real>(get_value(rhs));
-	if (lhs->type().type == MOT::MO_INTEGER && rhs->type().type == MOT::MO_INTEGER)
+	if (lhs_value->type().type == MOT::MO_INTEGER && rhs_value->type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(lhs_value->value() / rhs_value->value());
+		return std::make_shared<Integer>(integer_divide(lhs_value->as<Integer>()->value(), rhs_value->as<Integer>()->value()));
 	}
 	else
 	{
@@ -64,9 +123,9 @@ BuiltinOpFunc ml__exponentiate__real_real = [](std::shared_ptr<MathObj> & lhs, s
 {
 	auto lhs_value = std::static_pointer_cast<Real>(get_value(lhs));
 	auto rhs_value = std::static_pointer_cast<Real>(get_value(rhs));
-	if (lhs->type().type == MOT::MO_INTEGER && rhs->type().type == MOT::MO_INTEGER)
+	if (lhs_value->type().type == MOT::MO_INTEGER && rhs_value->type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(std::pow(lhs_value->value(), rhs_value->value()));
+		return std::make_shared<Integer>(integer_power(lhs_value->as<Integer>()->value(), rhs_value->as<Integer>()->value()));
 	}
 	else
 	{
@@ -78,9 +137,10 @@ BuiltinOpFunc ml__assign__real_real = [](std::shared_ptr<MathObj> & lhs, std::sh
 {
 	if (lhs->type().type == MOT::MO_VARIABLE)
 	{
+		// Store the value itself so that the variable does not alias the right-hand side
 		auto & lhs_val = static_cast<Variable &>(*lhs);
-		lhs_val.value = rhs;
-		return rhs;
+		lhs_val.value = get_value(rhs);
+		return lhs_val.value;
 	}
 	else
 	{
@@ -90,12 +150,12 @@ BuiltinOpFunc ml__assign__real_real = [](std::shared_ptr<MathObj> & lhs, std::sh
 };
 
 // * Unary operators
-BuiltinOpFunc ml__negate__real = [](std::shared_ptr<MathObj> & operand, std::shared_ptr<MathObj> &) -> std::shared_ptr<MathObj>
+BuiltinOpFunc ml__negate__real = [](std::shared_ptr<MathObj> &, std::shared_ptr<MathObj> & operand) -> std::shared_ptr<MathObj>
 {
 	auto & operand_val = static_cast<const Real &>(*get_value(operand));
-	if (operand->type().type == MOT::MO_INTEGER)
+	if (operand_val.type().type == MOT::MO_INTEGER)
 	{
-		return std::make_shared<Integer>(-operand_val.value());
+		return std::make_shared<Integer>(wrapping_subtract(0, static_cast<const Integer &>(operand_val).value()));
 	}
 	else
 	{
@@ -103,15 +163,28 @@ BuiltinOpFunc ml__negate__real = [](std::shared_ptr<MathObj> & operand, std::sha
 	}
 };
 
+// Internal operator produced by the strength reduction of `x ^ 0.5`
+BuiltinOpFunc ml__sqrt__real = [](std::shared_ptr<MathObj> &, std::shared_ptr<MathObj> & operand) -> std::shared_ptr<MathObj>
+{
+	double value = static_cast<const Real &>(*get_value(operand)).value();
+	// `std::pow` differs from `std::sqrt` for -0, -inf and the sign of NaN
+	if (value > 0)
+		return std::make_shared<Real>(std::sqrt(value));
+	return std::make_shared<Real>(std::pow(value, 0.5));
+};
+
 BuiltinOpFunc ml__print__real = [](std::shared_ptr<MathObj> &, std::shared_ptr<MathObj> & operand) -> std::shared_ptr<MathObj>
 {
-	auto operand_val = std::static_pointer_cast<Real>(get_value(operand));
-	std::cout << operand_val->to_string();
+	auto operand_val = get_value(operand);
+	if (operand_val->type().type == MOT::MO_INTEGER)
+		OutputBuffer::active->write_integer(operand_val->as<Integer>()->value());
+	else
+		OutputBuffer::active->write_real(operand_val->as<Real>()->value());
 	return std::make_shared<None>();
 };
 
 BuiltinOpFunc ml__print__none = [](std::shared_ptr<MathObj> &, std::shared_ptr<MathObj> & operand) -> std::shared_ptr<MathObj>
 {
-	std::cout << "none";
+	OutputBuffer::active->write("none");
 	return std::make_shared<None>();
 };
\ No newline at end of file
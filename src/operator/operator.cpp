@@ -10,6 +10,18 @@ std::pair<OpImplementations::const_iterator, OpImplementations::const_iterator>
 	return implementations.equal_range(s_op_name);
 }
 
+std::shared_ptr<const OperatorFunction> OperatorTable::find_implementation(std::string_view op_name, std::pair<MathObjType, MathObjType> arg_types, bool unary) const
+{
+	auto [begin, end] = get_implementations(op_name, unary);
+	for (auto it = begin; it != end; it++)
+	{
+		auto & types = it->second->arg_types;
+		if (types.first.type == arg_types.first.type && (unary || types.second.type == arg_types.second.type))
+			return it->second;
+	}
+	return nullptr;
+}
+
 std::shared_ptr<const Operator> OperatorTable::find(std::string_view op_name) const
 {
 	std::string s_op_name(op_name);
@@ -19,11 +31,69 @@ std::shared_ptr<const Operator> OperatorTable::find(std::string_view op_name) co
 	return nullptr;
 }
 
+uint8_t OperatorTable::operator_id(const std::string & name)
+{
+	auto [it, inserted] = operator_ids.try_emplace(name, operator_ids.size());
+	if (inserted)
+	{
+		binary_dispatch.resize(operator_ids.size() * TYPE_SLOTS * TYPE_SLOTS);
+		unary_dispatch.resize(operator_ids.size() * TYPE_SLOTS);
+	}
+	return it->second;
+}
+
+void OperatorTable::build_binary_dispatch(const std::string & name)
+{
+	auto [begin, end] = binary_implemetations.equal_range(name);
+	OperatorDispatch * row = &binary_dispatch[operator_id(name) * TYPE_SLOTS * TYPE_SLOTS];
+	for (size_t left = 0; left < TYPE_SLOTS; left++)
+	{
+		for (size_t right = 0; right < TYPE_SLOTS; right++)
+		{
+			// The candidate with the unique highest specificity (ambiguous if it is shared)
+			OperatorDispatch dispatch { DispatchStatus::D_NO_MATCH };
+			int best_specificity = 0;
+			for (auto it = begin; it != end; it++)
+			{
+				auto & arg_types = it->second->arg_types;
+				int specificity = calculate_specificity(slot_type(left), slot_type(right), arg_types.first, arg_types.second);
+				if (specificity > best_specificity)
+				{
+					dispatch = { DispatchStatus::D_MATCH, it->second.get() };
+					best_specificity = specificity;
+				}
+				else if (specificity > 0 && specificity == best_specificity)
+					dispatch.status = DispatchStatus::D_AMBIGUOUS;
+			}
+			row[left * TYPE_SLOTS + right] = dispatch;
+		}
+	}
+}
+
+void OperatorTable::build_unary_dispatch(const std::string & name)
+{
+	auto [begin, end] = unary_implemetations.equal_range(name);
+	OperatorDispatch * row = &unary_dispatch[operator_id(name) * TYPE_SLOTS];
+	for (size_t slot = 0; slot < TYPE_SLOTS; slot++)
+	{
+		OperatorDispatch dispatch { DispatchStatus::D_NO_MATCH };
+		for (auto it = begin; it != end; it++)
+		{
+			if (can_convert(slot_type(slot), it->second->arg_types.first))
+			{
+				dispatch = { DispatchStatus::D_MATCH, it->second.get() };
+				break;
+			}
+		}
+		row[slot] = dispatch;
+	}
+}
+
 void OperatorTable::register_operator(std::string name, Fixity fixity, Precedence precedence)
 {
-	operators.emplace(name, std::make_shared<Operator>(name, fixity, precedence));
+	operators.emplace(name, std::make_shared<Operator>(name, fixity, precedence, operator_id(name)));
 }
-void OperatorTable::register_unary_implementation(std::string name, BuiltinOpFunc & implementation, MathObjType arg_type, MathObjType ret_type)
+void OperatorTable::register_unary_implementation(std::string name, BuiltinOpFunc & implementation, MathObjType arg_type, MathObjType ret_type, bool is_pure, bool can_trap)
 {
 	unary_implemetations.emplace(
 		name,
@@ -31,20 +101,26 @@ void OperatorTable::register_unary_implementation(std::string name, BuiltinOpFun
 			OperatorType::O_BUILTIN,
 			implementation,
 			std::make_pair(arg_type, MathObjType::MO_NONE),
-			ret_type
+			ret_type,
+			is_pure,
+			can_trap
 		)
 	);
+	build_unary_dispatch(name);
 }
-void OperatorTable::register_binary_implementation(std::string name, BuiltinOpFunc & implementation, std::pair<MathObjType, MathObjType> arg_types, MathObjType ret_type)
+void OperatorTable::register_binary_implementation(std::string name, BuiltinOpFunc & implementation, std::pair<MathObjType, MathObjType> arg_types, MathObjType ret_type, bool is_pure, bool can_trap)
 {
 	binary_implemetations.emplace(
 		name,
 		std::make_shared<OperatorFunction>(
 			OperatorType::O_BUILTIN,
 			implementation,
-			arg_types, ret_type
+			arg_types, ret_type,
+			is_pure,
+			can_trap
 		)
 	);
+	build_binary_dispatch(name);
 }
 
 void OperatorTable::register_builtin_operators(void)
@@ -73,19 +149,23 @@ void OperatorTable::register_builtin_operators(void)
 	REG_BIN_IMP("*", ml__multiply__real_real, {MOT::MO_REAL, MOT::MO_REAL}, MOT::MO_REAL);
 	REG_BIN_IMP("*", ml__multiply__real_real, {MOT::MO_INTEGER, MOT::MO_INTEGER}, MOT::MO_INTEGER);
 
-	REG_BIN_IMP("/", ml__divide__real_real, {MOT::MO_REAL, MOT::MO_REAL}, MOT::MO_REAL);
-	REG_BIN_IMP("/", ml__divide__real_real, {MOT::MO_INTEGER, MOT::MO_INTEGER}, MOT::MO_INTEGER);
+	// A real operand can hold an integer, so both implementations can fail on integers
+	REG_BIN_IMP("/", ml__divide__real_real, {MOT::MO_REAL, MOT::MO_REAL}, MOT::MO_REAL, true, true);
+	REG_BIN_IMP("/", ml__divide__real_real, {MOT::MO_INTEGER, MOT::MO_INTEGER}, MOT::MO_INTEGER, true, true);
 
-	REG_BIN_IMP("^", ml__exponentiate__real_real, {MOT::MO_REAL, MOT::MO_REAL}, MOT::MO_REAL);
-	REG_BIN_IMP("^", ml__exponentiate__real_real, {MOT::MO_INTEGER, MOT::MO_INTEGER}, MOT::MO_INTEGER);
+	REG_BIN_IMP("^", ml__exponentiate__real_real, {MOT::MO_REAL, MOT::MO_REAL}, MOT::MO_REAL, true, true);
+	REG_BIN_IMP("^", ml__exponentiate__real_real, {MOT::MO_INTEGER, MOT::MO_INTEGER}, MOT::MO_INTEGER, true, true);
 
-	REG_BIN_IMP("=", ml__assign__real_real, {{MOT::MO_REAL, false}, MOT::MO_REAL}, MOT::MO_REAL);
-	REG_BIN_IMP("=", ml__assign__real_real, {{MOT::MO_INTEGER, false}, MOT::MO_INTEGER}, MOT::MO_INTEGER);
+	REG_BIN_IMP("=", ml__assign__real_real, {{MOT::MO_REAL, false}, MOT::MO_REAL}, MOT::MO_REAL, false);
+	REG_BIN_IMP("=", ml__assign__real_real, {{MOT::MO_INTEGER, false}, MOT::MO_INTEGER}, MOT::MO_INTEGER, false);
 
 	// Unary operators
 	REG_UN_IMP("-", ml__negate__real, MOT::MO_REAL, MOT::MO_REAL);
 	REG_UN_IMP("-", ml__negate__real, MOT::MO_INTEGER, MOT::MO_INTEGER);
 
-	REG_UN_IMP("print", ml__print__real, MOT::MO_REAL, MOT::MO_NONE);
-	REG_UN_IMP("print", ml__print__none, MOT::MO_NONE, MOT::MO_NONE);
+	// Internal operators (not registered above, so they cannot appear in the source)
+	REG_UN_IMP("sqrt", ml__sqrt__real, MOT::MO_REAL, MOT::MO_REAL);
+
+	REG_UN_IMP("print", ml__print__real, MOT::MO_REAL, MOT::MO_NONE, false);
+	REG_UN_IMP("print", ml__print__none, MOT::MO_NONE, MOT::MO_NONE, false);
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "ast.h"
+
+NodeList AST::make_list(std::span<const NodeIndex> nodes)
+{
+	if (nodes.empty())
+		return NodeList {};
+	return NodeList { arena.make_array(nodes.data(), nodes.size()), (uint32_t)nodes.size() };
+}
+
+std::span<const NodeIndex> AST::list(NodeList list) const
+{
+	if (list.size == 0)
+		return {};
+	return { arena.get_array<NodeIndex>(list.first), list.size };
+}
\ No newline at end of file
@@ -4,16 +4,152 @@
 #include "vm.h"
 #include "token.h"
 #include "globals.h"
+#include "scan.h"
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
+#include <thread>
 
 std::shared_ptr<Lexer> lexer;
 
 bool is_operator_sym(char c);
 
-std::unique_ptr<Token> Lexer::scan_tk(void)
+std::vector<Token> Lexer::tokenize(void)
 {
-	std::unique_ptr<Token> token;
+	std::vector<Token> tokens;
+	// Rough estimate of the number of tokens, to avoid most reallocations
+	tokens.reserve(source.length() / 4 + 1);
+
+	do
+		tokens.push_back(scan_tk());
+	while (!tokens.back().is_eof());
+
+	return tokens;
+}
+
+std::vector<Token> Lexer::tokenize_parallel(unsigned threads)
+{
+	// There are only line comments and no token spans lines, so every line starts outside of
+	// a token or a comment: segments of whole lines are scanned exactly as in the whole source.
+	// Scanning stops at the first NUL, so the segments end there
+	std::string_view scanned = source.substr(0, source.find('\0'));
+	size_t segment_count = std::min<size_t>(threads, scanned.length() / PARALLEL_SEGMENT_BYTES);
+	if (segment_count < 2 || pos != 0)
+		return tokenize();
+
+	std::vector<size_t> bounds { 0 };
+	for (size_t i = 1; i < segment_count; i++)
+	{
+		size_t newline = scanned.find('\n', std::max(bounds.back(), scanned.length() / segment_count * i));
+		if (newline == std::string_view::npos)
+			break;
+		bounds.push_back(newline + 1);
+	}
+	bounds.push_back(scanned.length());
+
+	// Each segment interns its names in its own table (the tables are merged below)
+	struct Segment
+	{
+		std::vector<Token> tokens;
+		std::shared_ptr<SymbolTable> symbols = std::make_shared<SymbolTable>();
+		std::vector<std::unique_ptr<Error>> errors;
+		std::exception_ptr failure;
+	};
+	std::vector<Segment> segments(bounds.size() - 1);
+	auto scan_segment = [&](size_t i)
+	{
+		try
+		{
+			Lexer lexer(source.substr(0, bounds[i + 1]), segments[i].symbols, bounds[i]);
+			segments[i].tokens = lexer.tokenize();
+			if (i + 1 < segments.size())
+				segments[i].tokens.pop_back(); // EOF
+		}
+		catch (...)
+		{
+			segments[i].failure = std::current_exception();
+		}
+		// Errors are kept per thread (those of the first segment are on this one already)
+		if (i > 0)
+			segments[i].errors = ErrorHandler::take_errors();
+	};
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < segments.size(); i++)
+		workers.emplace_back(scan_segment, i);
+	scan_segment(0);
+	for (auto & worker : workers)
+		worker.join();
+
+	// Names are interned in order of first appearance, as in one pass, and the ids of the
+	// segments are mapped to them
+	std::vector<std::vector<SymbolId>> ids(segments.size());
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (segments[i].failure)
+			std::rethrow_exception(segments[i].failure);
+		ErrorHandler::push_errors(std::move(segments[i].errors));
+
+		SymbolTable & local = *segments[i].symbols;
+		for (SymbolId symbol = 0; symbol < local.size(); symbol++)
+			ids[i].push_back(symbols->intern(local.name(symbol)));
+	}
+
+	auto map_segment = [&](size_t i)
+	{
+		for (Token & token : segments[i].tokens)
+			if (token.symbol() != NO_SYMBOL)
+				token = Token(token.type(), token.lexeme(), token.position(), ids[i][token.symbol()]);
+	};
+	workers.clear();
+	for (size_t i = 1; i < segments.size(); i++)
+		workers.emplace_back(map_segment, i);
+	map_segment(0);
+	for (auto & worker : workers)
+		worker.join();
+
+	std::vector<Token> tokens = std::move(segments[0].tokens);
+	size_t count = 0;
+	for (auto & segment : segments)
+		count += segment.tokens.size();
+	tokens.reserve(count);
+	for (size_t i = 1; i < segments.size(); i++)
+		tokens.insert(tokens.end(), segments[i].tokens.begin(), segments[i].tokens.end());
+	return tokens;
+}
+
+std::vector<Token> Lexer::tokenize_statements(size_t min_tokens)
+{
+	std::vector<Token> tokens;
+	tokens.reserve(min_tokens + 1);
+
+	// Statements end with `;` or with the `}` of a block or function body, outside of braces
+	size_t depth = 0;
+	while (true)
+	{
+		tokens.push_back(scan_tk());
+		const Token & token = tokens.back();
+		if (token.is_eof())
+			return tokens;
+
+		if (token.type() == TokenType::T_LEFT_BRACE)
+			depth++;
+		else if (token.type() == TokenType::T_RIGHT_BRACE && depth > 0)
+			depth--;
+		else if (token.type() != TokenType::T_SEMICOLON)
+			continue;
+
+		if (depth == 0 && tokens.size() >= min_tokens)
+			break;
+	}
+
+	tokens.push_back(Token(TokenType::T_EOF, "", pos));
+	return tokens;
+}
+
+Token Lexer::scan_tk(void)
+{
+	Token token(TokenType::T_ERROR, "", pos);
 
 	skip_whites(); // skips comments too
 	char curr { peek() }, next { peek_next() };
@@ -43,25 +179,27 @@ std::unique_ptr<Token> Lexer::scan_tk(void)
 	{
 		if (curr == ':' && next == '-' && peek(2) == '>' && !is_operator_sym(peek(3)))
 		{
-			token = make_tk(TokenType::T_COLON_ARROW, ":->", column, pos);
+			token = make_tk(TokenType::T_COLON_ARROW, ":->", pos);
 			advance(3);
 		}
 		else if (curr == ':')
 		{
 			if (next == '=' && !is_operator_sym(peek(2)))
 			{
-				token = make_tk(TokenType::T_COLON_EQUAL, ":=", column, pos);
+				token = make_tk(TokenType::T_COLON_EQUAL, ":=", pos);
 				advance(2);
 			}
 			else if (!is_operator_sym(next))
 			{
-				token = make_tk(TokenType::T_COLON, ":", column, pos);
+				token = make_tk(TokenType::T_COLON, ":", pos);
 				advance();
 			}
+			else
+				token = make_operator_tk();
 		}
 		else if (curr == '-' && next == '>' && !is_operator_sym(peek(2)))
 		{
-			token = make_tk(TokenType::T_ARROW, "->", column, pos);
+			token = make_tk(TokenType::T_ARROW, "->", pos);
 			advance(2);
 		}
 		else
@@ -73,37 +211,37 @@ std::unique_ptr<Token> Lexer::scan_tk(void)
 	{
 		// * SPECIAL SYMBOLS
 		case ',':
-			token = make_tk(TokenType::T_COMMA, ",", column, pos);
+			token = make_tk(TokenType::T_COMMA, ",", pos);
 			break;
 		case ';':
-			token = make_tk(TokenType::T_SEMICOLON, ";", column, pos);
+			token = make_tk(TokenType::T_SEMICOLON, ";", pos);
 			break;
 		case '(':
-			token = make_tk(TokenType::T_LEFT_PAREN, "(", column, pos);
+			token = make_tk(TokenType::T_LEFT_PAREN, "(", pos);
 			break;
 		case ')':
-			token = make_tk(TokenType::T_RIGHT_PAREN, ")", column, pos);
+			token = make_tk(TokenType::T_RIGHT_PAREN, ")", pos);
 			break;
 		case '[':
-			token = make_tk(TokenType::T_LEFT_BRACKET, "[", column, pos);
+			token = make_tk(TokenType::T_LEFT_BRACKET, "[", pos);
 			break;
 		case ']':
-			token = make_tk(TokenType::T_RIGHT_BRACKET, "]", column, pos);
+			token = make_tk(TokenType::T_RIGHT_BRACKET, "]", pos);
 			break;
 		case '{':
-			token = make_tk(TokenType::T_LEFT_BRACE, "{", column, pos);
+			token = make_tk(TokenType::T_LEFT_BRACE, "{", pos);
 			break;
 		case '}':
-			token = make_tk(TokenType::T_RIGHT_BRACE, "}", column, pos);
+			token = make_tk(TokenType::T_RIGHT_BRACE, "}", pos);
 			break;
 
 		// * OTHERS
 		case '\0':
-			token = std::make_unique<EOFToken>(line, column, pos);
+			token = make_tk(TokenType::T_EOF, "", pos);
 			break;
 		
 		default:
-			token = make_tk(TokenType::T_ERROR, "", column, pos);
+			token = make_tk(TokenType::T_ERROR, "", pos);
 			break;
 	}
 
@@ -112,10 +250,10 @@ std::unique_ptr<Token> Lexer::scan_tk(void)
 	return token;
 }
 
-std::unique_ptr<Token> Lexer::make_operator_tk(void)
+Token Lexer::make_operator_tk(void)
 {
 	size_t lexeme_length = 1; 
-	size_t start_pos = pos, start_col = column;
+	size_t start_pos = pos;
 
 	advance();
 	char c = peek();
@@ -127,69 +265,44 @@ std::unique_ptr<Token> Lexer::make_operator_tk(void)
 	}
 	
 	std::string_view lexeme = source.substr(start_pos, lexeme_length);
-	return make_tk(TokenType::T_OPERATOR_SYM, lexeme, start_col, start_pos);
+	return make_tk(TokenType::T_OPERATOR_SYM, lexeme, start_pos);
 }
 
-std::unique_ptr<Token> Lexer::make_word_tk(void)
+Token Lexer::make_word_tk(void)
 {
-	size_t lexeme_length = 1; 
-	size_t start_pos = pos, start_col = column;
+	size_t start_pos = pos;
 
 	advance();
-	char c = peek();
-	while (!at_end() && (isalnum(c) || c == '_'))
-	{
-		advance();
-		c = peek();
-		lexeme_length++;
-	}
+	size_t lexeme_length = 1 + advance_over(scan_word_chars);
 	
 	std::string_view lexeme = source.substr(start_pos, lexeme_length);
 	TokenType t_type = check_word_t_type(lexeme);
+	if (t_type == TokenType::T_IDENTIFIER)
+		return Token(t_type, lexeme, start_pos, symbols->intern(lexeme));
 
-	return make_tk(t_type, lexeme, start_col, start_pos);
+	return make_tk(t_type, lexeme, start_pos);
 }
 
-std::unique_ptr<Token> Lexer::make_number_tk(void)
+Token Lexer::make_number_tk(void)
 {
-	size_t lexeme_length = 1; 
-	size_t start_pos = pos, start_col = column;
+	size_t start_pos = pos;
 
-	/* Because we jumped one character ahead,
-	   we need to check if the character is a dot
-	   or just a regular digit (the check was done in `scan_t`)
-	   before we move to the next character.
-	   This is to support the format: . d [d*]
+	/* The first character is a digit or a dot (the check was done in `scan_tk`),
+	   which is counted with the others to support the format: . d [d*]
 	*/
-	bool has_dot = (peek() == '.');
-	bool is_error = false;
-
 	advance();
-	char c = peek();
-	while (!at_end() && (isdigit(c) || c == '.'))
-	{
-		if (c == '.')
-		{
-			if (has_dot)
-				is_error = true;
-
-			has_dot = true;
-		}
-
-		advance();
-		c = peek();
-		lexeme_length++;
-	}
+	size_t lexeme_length = 1 + advance_over(scan_number_chars);
 
 	std::string_view lexeme = source.substr(start_pos, lexeme_length);
+	auto dots = std::count(lexeme.begin(), lexeme.end(), '.');
+	bool has_dot = (dots > 0);
+	bool is_error = (dots > 1);
 
 	if (is_error)
 	{
 		std::unique_ptr<Error> t_err { new LexicalError(
 			lexeme,
 			"too many decimal points in number",
-			line,
-			start_col,
 			start_pos
 		)};
 		ErrorHandler::push_error(t_err);
@@ -202,18 +315,15 @@ std::unique_ptr<Token> Lexer::make_number_tk(void)
 				TokenType::T_REAL_LITERAL :
 				TokenType::T_INTEGER_LITERAL),
 		lexeme,
-		start_col,
 		start_pos
 	);
 }
 
-std::unique_ptr<Token> Lexer::make_tk(TokenType type, std::string_view lexeme, size_t start_column, size_t start_pos)
+Token Lexer::make_tk(TokenType type, std::string_view lexeme, size_t start_pos)
 {
-	return std::make_unique<Token>(
+	return Token(
 		type,
 		lexeme,
-		line,
-		start_column,
 		start_pos
 	);
 }
@@ -222,17 +332,10 @@ void Lexer::skip_whites(void)
 {
 	while (!at_end())
 	{
+		advance_over(scan_blanks);
 		switch (peek())
 		{
-			case ' ': case '\r':
-				advance();
-				break;
-			case '\t':
-				advance();
-				break;
 			case '\n':
-				line++;
-				column = 0;
 				advance();
 				break;
 			case '/':
@@ -248,10 +351,13 @@ void Lexer::skip_whites(void)
 }
 
 void Lexer::skip_comment(void)
+{ advance_over(scan_line); }
+
+size_t Lexer::advance_over(size_t (*scan)(const char * begin, const char * end))
 {
-	advance();
-	while (!at_end() && peek() != '\n')
-		advance();
+	size_t length = scan(source.data() + pos, source.data() + source.length());
+	pos += length;
+	return length;
 }
 
 bool is_operator_sym(char c)
@@ -282,7 +388,7 @@ char Lexer::advance(int jump)
 {
 	if (source.length() < pos + jump )
 		return '\0';
-	pos += jump; column += jump;
+	pos += jump;
 	return source[pos - jump];
 }
 
@@ -1,3 +1,5 @@
+#include <charconv>
+
 #include "parser.h"
 #include "globals.h"
 #include "ast.h"
@@ -17,15 +19,27 @@ void Parser::parse_source(void)
 	}
 }
 
-Parser::Parser(Lexer & lexer) : lexer(std::make_unique<Lexer>(lexer))
+Parser::Parser(Lexer & lexer, std::shared_ptr<OperatorTable> operators) :
+	Parser(lexer.tokenize(), lexer.get_source(), std::move(operators))
+{}
+
+Parser::Parser(std::vector<Token> tokens, std::string_view source, std::shared_ptr<OperatorTable> operators) :
+	tokens(std::move(tokens)),
+	operators(std::move(operators))
 {
 	panic_mode = false;
+	if (config::print_lexer_output)
+		token_lines = std::make_unique<LineIndex>(source);
+}
 
-	operators = std::make_unique<OperatorTable>();
-	operators->register_builtin_operators();
+NodeList Parser::make_list(size_t list_start)
+{
+	NodeList list = ast.make_list(std::span(list_stack).subspan(list_start));
+	list_stack.resize(list_start);
+	return list;
 }
 
-std::unique_ptr<ASTNode> Parser::statement_n(void)
+NodeIndex Parser::statement_n(void)
 {
 	switch (curr_tk->type())
 	{
@@ -45,95 +59,93 @@ std::unique_ptr<ASTNode> Parser::statement_n(void)
 			return return_statement_n();
 		
 		case TokenType::T_EOF:
-			return nullptr;
+			return NO_NODE;
 
 		default:
 			return expression_statement_n();
 	}
 }
 
-std::unique_ptr<BlockNode> Parser::block_n(void)
+NodeIndex Parser::block_n(void)
 {
-	std::unique_ptr<BlockNode> block_node { new BlockNode };
-	block_node->line = curr_tk->line();
-	block_node->column = curr_tk->column();
+	auto [index, block_node] = ast.make<BlockNode>();
+	block_node->location = curr_tk->position();
 	block_node->start_position = curr_tk->position();
 
+	size_t list_start = list_stack.size();
 	while (consume_tk() && curr_tk->type() != TokenType::T_RIGHT_BRACE && curr_tk->type() != TokenType::T_EOF)
 	{
-		block_node
-			->statements
-			.push_back(statement_n());
+		NodeIndex statement = statement_n();
+		list_stack.push_back(statement);
 	}
+	block_node->statements = make_list(list_start);
 
 	expect_tk(TokenType::T_RIGHT_BRACE, "`}` expected after block");
 
 	block_node->end_position = curr_tk->position() + 1;
-	return block_node;
+	return index;
 }
 
-std::unique_ptr<ReturnNode> Parser::return_n(void)
+NodeIndex Parser::return_n(void)
 {
-	std::unique_ptr<ReturnNode> return_node { new ReturnNode };
-	return_node->line = curr_tk->line();
-	return_node->column = curr_tk->column();
+	auto [index, return_node] = ast.make<ReturnNode>();
+	return_node->location = curr_tk->position();
 	return_node->start_position = curr_tk->position();
 	return_node->end_position = curr_tk->position() + curr_tk->lexeme().length();
 	consume_tk(); // consume `return`
 	expect_tk(TokenType::T_SEMICOLON, "`;` expected after return statement");
-	return return_node;
+	return index;
 }
 
-std::unique_ptr<ReturnStatementNode> Parser::return_statement_n(void)
+NodeIndex Parser::return_statement_n(void)
 {
-	std::unique_ptr<ReturnStatementNode> return_stmt_node { new ReturnStatementNode };
-	return_stmt_node->line = curr_tk->line();
-	return_stmt_node->column = curr_tk->column();
+	auto [index, return_stmt_node] = ast.make<ReturnStatementNode>();
+	return_stmt_node->location = curr_tk->position();
 	return_stmt_node->start_position = curr_tk->position();
 
 	consume_tk(); // consume `:->`
 
 	return_stmt_node->value = expression_n(P_MIN);
-	if (!return_stmt_node->value)
+	if (return_stmt_node->value == NO_NODE)
 	{
 		register_syntax_error("expression expected after `:->`");
-		return nullptr;
+		return NO_NODE;
 	}
 	expect_tk(TokenType::T_SEMICOLON, "`;` expected after return statement");
 
-	return_stmt_node->end_position = return_stmt_node->value->end_position;
-	return return_stmt_node;
+	return_stmt_node->end_position = ast.node(return_stmt_node->value).end_position;
+	return index;
 }
 
-std::unique_ptr<FunctionDeclarationNode> Parser::function_declaration_n(void)
+NodeIndex Parser::function_declaration_n(void)
 {
-	std::unique_ptr<FunctionDeclarationNode> func_dec_node { new FunctionDeclarationNode };
-	func_dec_node->line = curr_tk->line();
-	func_dec_node->column = curr_tk->column();
+	auto [index, func_dec_node] = ast.make<FunctionDeclarationNode>();
+	func_dec_node->location = curr_tk->position();
 	func_dec_node->start_position = curr_tk->position();
 
 	consume_tk(); // consume `define`
 
 	func_dec_node->name = identifier_n();
-	if (!func_dec_node->name)
+	if (func_dec_node->name == NO_NODE)
 	{
 		register_syntax_error("identifier expected after `define`");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 
 	expect_tk(TokenType::T_LEFT_PAREN, "`(` expected after function name");
+	size_t list_start = list_stack.size();
 	while (consume_tk()
 		&& curr_tk->type() != TokenType::T_RIGHT_PAREN
 		&& curr_tk->type() != TokenType::T_EOF)
 	{
-		func_dec_node
-			->parameters
-			.push_back(parameter_n());
+		NodeIndex parameter = parameter_n();
+		list_stack.push_back(parameter);
 
 		if (curr_tk->type() != TokenType::T_COMMA)
 			break;
 	}
+	func_dec_node->parameters = make_list(list_start);
 	expect_tk(TokenType::T_RIGHT_PAREN, "`)` expected after function parameters");
 
 	if (next_tk->type() == TokenType::T_ARROW)
@@ -141,10 +153,10 @@ std::unique_ptr<FunctionDeclarationNode> Parser::function_declaration_n(void)
 		consume_tk(); // consume `)`
 		consume_tk(); // consume `->`
 		func_dec_node->return_type = type_n();
-		if (!func_dec_node->return_type)
+		if (func_dec_node->return_type == NO_NODE)
 		{
 			register_syntax_error("return type expected after `->`");
-			return nullptr;
+			return NO_NODE;
 		}
 		func_dec_node->end_position = curr_tk->position() + curr_tk->lexeme().length();
 		consume_tk();
@@ -153,78 +165,77 @@ std::unique_ptr<FunctionDeclarationNode> Parser::function_declaration_n(void)
 	{
 		func_dec_node->end_position = curr_tk->position() + 1;
 		consume_tk(); // consume `)`
-		func_dec_node->return_type = std::make_unique<TypeNode>(MathObjType(MOT::MO_NONE));
+		func_dec_node->return_type = ast.make<TypeNode>(MathObjType(MOT::MO_NONE)).first;
 	}
 
 	expect_tk(TokenType::T_LEFT_BRACE, "`{` expected after function declaration");
 
 	func_dec_node->body = block_n();
-	if (!func_dec_node->body)
+	if (func_dec_node->body == NO_NODE)
 	{
 		register_syntax_error("function body expected");
-		return nullptr;
+		return NO_NODE;
 	}
 
-	return func_dec_node;
+	return index;
 }
 
-std::unique_ptr<FunctionCallNode> Parser::function_call_n(void)
+NodeIndex Parser::function_call_n(void)
 {
-	std::unique_ptr<FunctionCallNode> func_call_node { new FunctionCallNode };
-	func_call_node->line = curr_tk->line();
-	func_call_node->column = curr_tk->column();
+	auto [index, func_call_node] = ast.make<FunctionCallNode>();
+	func_call_node->location = curr_tk->position();
 	func_call_node->start_position = curr_tk->position();
 
 	func_call_node->name = identifier_n();
-	if (!func_call_node->name)
+	if (func_call_node->name == NO_NODE)
 	{
 		register_syntax_error("identifier expected as function name");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 
 	// just in case of a bug
 	expect_tk(TokenType::T_LEFT_PAREN, "`(` expected after function name");
+	size_t list_start = list_stack.size();
 	while (consume_tk()
 		&& curr_tk->type() != TokenType::T_RIGHT_PAREN
 		&& curr_tk->type() != TokenType::T_EOF)
 	{
-		func_call_node
-			->arguments
-			.push_back(expression_n(P_MIN));
+		NodeIndex argument = expression_n(P_MIN);
+		list_stack.push_back(argument);
 		panic_mode = false;
 
 		if (curr_tk->type() != TokenType::T_COMMA)
 			break;
 	}
+	func_call_node->arguments = make_list(list_start);
 	expect_tk(TokenType::T_RIGHT_PAREN, "`)` expected after function arguments");
 
 	func_call_node->end_position = curr_tk->position() + 1;
-	return func_call_node;
+	return index;
 }
 
-std::unique_ptr<ParameterNode> Parser::parameter_n(void)
+NodeIndex Parser::parameter_n(void)
 {
-	std::unique_ptr<ParameterNode> param_node { new ParameterNode };
-	param_node->line = curr_tk->line();
-	param_node->column = curr_tk->column();
+	auto [index, param_node] = ast.make<ParameterNode>();
+	param_node->location = curr_tk->position();
 	param_node->start_position = curr_tk->position();
 
 	param_node->name = identifier_n();
-	if (!param_node->name)
+	if (param_node->name == NO_NODE)
 	{
 		register_syntax_error("identifier expected as parameter name");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 
 	expect_tk(TokenType::T_COLON, "`:` expected after parameter name");
 	consume_tk(); // consume `:`
 	param_node->type = type_n();
-	if (!param_node->type)
+	if (param_node->type == NO_NODE)
 	{
 		register_syntax_error("type expected after `:`");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 
@@ -233,35 +244,30 @@ std::unique_ptr<ParameterNode> Parser::parameter_n(void)
 		consume_tk(); // consume `=`
 		param_node->default_value = expression_n(P_MIN);
 	}
-	else
-	{
-		param_node->default_value = nullptr;
-	}
 
 	param_node->end_position = curr_tk->position() + 1;
-	return param_node;
+	return index;
 }
 
-std::unique_ptr<VariableDeclarationNode> Parser::variable_declaration_n(void)
+NodeIndex Parser::variable_declaration_n(void)
 {
 	consume_tk(); // consume `let`
-	std::unique_ptr<VariableDeclarationNode> var_dec_node { new VariableDeclarationNode };
-	var_dec_node->line = curr_tk->line();
+	auto [index, var_dec_node] = ast.make<VariableDeclarationNode>();
 	var_dec_node->start_position = curr_tk->position();
 
 	var_dec_node->type = type_n();
-	if (!var_dec_node->type || var_dec_node->type->type.type == MOT::MO_NONE)
+	if (var_dec_node->type == NO_NODE || ast.get<TypeNode>(var_dec_node->type).type.type == MOT::MO_NONE)
 	{
 		register_syntax_error("type expected after `let`");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 	
 	var_dec_node->name = identifier_n();
-	if (!var_dec_node->name)
+	if (var_dec_node->name == NO_NODE)
 	{
 		register_syntax_error("identifier expected after type");
-		return nullptr;
+		return NO_NODE;
 	}
 	consume_tk();
 
@@ -269,209 +275,240 @@ std::unique_ptr<VariableDeclarationNode> Parser::variable_declaration_n(void)
 	{
 		consume_tk(); // consume `:=`
 		var_dec_node->value = expression_n(P_MIN);
-		if (!var_dec_node->value)
+		if (var_dec_node->value == NO_NODE)
 		{
 			register_syntax_error("expression expected after `:=`");
-			return nullptr;
+			return NO_NODE;
 		}
 	}
-	else
-	{
-		var_dec_node->value = nullptr;
-	}
 	expect_tk(TokenType::T_SEMICOLON, "`;` expected after variable declaration");
 
-	var_dec_node->column = var_dec_node->name->column;
+	var_dec_node->location = ast.node(var_dec_node->name).location;
 	var_dec_node->end_position = curr_tk->position() + 1;
-	return var_dec_node;
+	return index;
 }
 
-std::unique_ptr<ExpressionStatementNode> Parser::expression_statement_n(void)
+NodeIndex Parser::expression_statement_n(void)
 {
-	std::unique_ptr<ExpressionStatementNode> expr_stmt_node { new ExpressionStatementNode };
+	auto [index, expr_stmt_node] = ast.make<ExpressionStatementNode>();
+	expr_stmt_node->location = curr_tk->position();
+	expr_stmt_node->start_position = curr_tk->position();
 
-	auto expr_node = expression_n(P_MIN);
-	if (!expr_node)
+	NodeIndex expr_node = expression_n(P_MIN);
+	if (expr_node == NO_NODE)
 	{
 		register_syntax_error("expression expected");
-		return nullptr;
+		return NO_NODE;
 	}
 	expect_tk(TokenType::T_SEMICOLON, "`;` expected after expression");
 
-	expr_stmt_node
-		->expressions
-		.push_back(move(expr_node));
+	expr_stmt_node->expressions = ast.make_list(std::span(&expr_node, 1));
+	expr_stmt_node->end_position = curr_tk->position() + 1;
 
-	return expr_stmt_node;
+	return index;
 }
 
-std::unique_ptr<ASTNode> Parser::expression_n(Precedence min_precedence)
+// Expressions are parsed without recursion: the expressions, operands and parentheses being parsed
+// are kept on `expression_stack`, and each node is handed to the frame below it once it is complete.
+// <expression> ::= <operand> { <operator> <operand> } (by precedence and fixity of the operators)
+// <operand> ::= [ <operator> ] <primary>
+// <primary> ::= <literal> | <function-call> | <identifier> | "(" <expression> ")" | <operand>
+NodeIndex Parser::expression_n(Precedence min_precedence)
 {
-	std::unique_ptr<ASTNode> left = operand_n();
-	if (!left)
-		return nullptr;
-	consume_tk();
+	using Frame = ExpressionFrame;
+	size_t base = expression_stack.size();
+	expression_stack.push_back(Frame::expression(min_precedence));
 
-	while (!curr_tk->is_eof() && curr_tk->type() == TokenType::T_OPERATOR_SYM)
+	NodeIndex node = NO_NODE;
+	bool operand_expected = true;
+	while (true)
 	{
-		auto op = operator_n();
-		if (!op || op->op_info->precedence < min_precedence)
-			break;
-
-		consume_tk(); // consume operator
-
-		if (op->op_info->fixity == Fixity::F_LEFT) // left associative
-		{
-			auto right = expression_n((Precedence)((int)op->op_info->precedence + 1));
-			left = std::make_unique<ExpressionNode>(
-				ExpressionNode(
-					move(left),
-					move(op),
-					move(right)
-				)
-			);
-		}
-		else // right associative
+		if (operand_expected)
 		{
-			auto right = expression_n(op->op_info->precedence);
-			left = std::make_unique<ExpressionNode>(
-				ExpressionNode(
-					move(left),
-					move(op),
-					move(right)
-				)
-			);
+			Frame operand = Frame::starting_at(Frame::F_OPERAND, *curr_tk);
+			operand.op = operator_n(true);
+			if (operand.op != NO_NODE)
+				consume_tk(); // consume operator
+			expression_stack.push_back(operand);
+
+			// Primary
+			if (curr_tk->is_literal())
+				node = literal_n();
+			else if (curr_tk->is_identifier() && next_tk->type() == TokenType::T_LEFT_PAREN)
+				node = function_call_n();
+			else if (curr_tk->is_identifier())
+				node = identifier_n();
+			else if (curr_tk->type() == TokenType::T_LEFT_PAREN)
+			{
+				expression_stack.push_back(Frame::starting_at(Frame::F_PARENTHESES, *curr_tk));
+				consume_tk(); // consume `(`
+				expression_stack.push_back(Frame::expression(P_MIN));
+				continue;
+			}
+			else if (curr_tk->type() == TokenType::T_OPERATOR_SYM)
+				continue; // Operand of the operand
+			else
+				node = NO_NODE;
+			operand_expected = false;
 		}
 
-		auto * expr = static_cast<ExpressionNode *>(left.get());
-		left->line = expr->left->line;
-		left->column = expr->left->column;
-		left->start_position = expr->left->start_position;
-		left->end_position = expr->right->end_position;
-	}
-
-	return left;
-}
-
-std::unique_ptr<ASTNode> Parser::operand_n(void)
-{
-	std::unique_ptr<OperandNode> operand_node { new OperandNode };
-	operand_node->line = curr_tk->line();
-	operand_node->column = curr_tk->column();
-	operand_node->start_position = curr_tk->position();
-
-	operand_node->op = operator_n(true);
-	if (operand_node->op)
-		consume_tk(); // consume operator
-	operand_node->primary = primary_n();
-
-	if (operand_node->primary)
-		operand_node->end_position = operand_node->primary->end_position;
-	else
-		return nullptr;
-
-	if (!operand_node->op)
-	{
-		auto & primary = operand_node->primary;
-		if (primary)
-			return move(primary);
-	}
-	
-	return operand_node;
-}
-
-std::unique_ptr<ASTNode> Parser::primary_n(void)
-{
-	if (curr_tk->is_literal())
-	{
-		return literal_n();
-	}
-	else if (curr_tk->is_identifier() && next_tk->type() == TokenType::T_LEFT_PAREN)
-	{
-		return function_call_n();
-	}
-	else if (curr_tk->is_identifier())
-	{
-		return identifier_n();
-	}
-	else if (curr_tk->type() == TokenType::T_LEFT_PAREN)
-	{
-		size_t line = curr_tk->line();
-		size_t column = curr_tk->column();
-		size_t start_position = curr_tk->position();
-
-		consume_tk(); // consume `(`
-		auto expr = expression_n(P_MIN);
-		if (!expr)
+		// Hand the complete node to the frame on top of the stack
+		Frame & frame = expression_stack.back();
+		switch (frame.kind)
 		{
-			register_syntax_error("expression expected");
-			return nullptr;
+			case Frame::F_OPERAND:
+			{
+				// An operand without operator is just its primary
+				if (node != NO_NODE && frame.op != NO_NODE)
+				{
+					auto [index, operand_node] = ast.make<OperandNode>();
+					operand_node->location = frame.start_position;
+					operand_node->start_position = frame.start_position;
+					operand_node->end_position = ast.node(node).end_position;
+					operand_node->op = frame.op;
+					operand_node->primary = node;
+					node = index;
+				}
+				expression_stack.pop_back();
+				break;
+			}
+			case Frame::F_PARENTHESES:
+			{
+				if (node == NO_NODE)
+				{
+					register_syntax_error("expression expected");
+					expression_stack.pop_back();
+					break;
+				}
+
+				ASTNode & expr_node = ast.node(node);
+				expr_node.location = frame.start_position;
+				expr_node.start_position = frame.start_position;
+				expect_tk(TokenType::T_RIGHT_PAREN, "`)` expected");
+
+				expr_node.end_position = curr_tk->position() + 1;
+				expression_stack.pop_back();
+				break;
+			}
+			case Frame::F_EXPRESSION:
+			{
+				if (frame.op == NO_NODE) // Left operand
+				{
+					if (node == NO_NODE)
+					{
+						expression_stack.pop_back();
+						break;
+					}
+					frame.left = node;
+					consume_tk();
+				}
+				else // Right operand (the tokens after it were read by its own frame)
+				{
+					if (node == NO_NODE)
+					{
+						register_syntax_error("expression expected");
+						expression_stack.pop_back();
+						break;
+					}
+
+					auto [index, expr] = ast.make<ExpressionNode>(frame.left, frame.op, node);
+					const ASTNode & left_node = ast.node(frame.left);
+					expr->location = left_node.location;
+					expr->start_position = left_node.start_position;
+					expr->end_position = ast.node(node).end_position;
+					frame.left = index;
+					frame.op = NO_NODE;
+				}
+
+				// The expression goes on while the next operator binds at least as tightly as allowed
+				NodeIndex op = NO_NODE;
+				if (!curr_tk->is_eof() && curr_tk->type() == TokenType::T_OPERATOR_SYM)
+					op = operator_n();
+				const Operator * op_info = op != NO_NODE ? ast.get<OperatorNode>(op).op_info : nullptr;
+				if (!op_info || op_info->precedence < frame.min_precedence)
+				{
+					node = frame.left;
+					expression_stack.pop_back();
+					break;
+				}
+
+				consume_tk(); // consume operator
+				frame.op = op;
+				// The right operand of a left associative operator only holds operators of higher precedence
+				expression_stack.push_back(Frame::expression(op_info->fixity == Fixity::F_LEFT ?
+					(Precedence)((int)op_info->precedence + 1) : op_info->precedence));
+				operand_expected = true;
+				continue;
+			}
 		}
 
-		expr->line = line;
-		expr->column = column;
-		expr->start_position = start_position;
-		expect_tk(TokenType::T_RIGHT_PAREN, "`)` expected");
-
-		expr->end_position = curr_tk->position() + 1;
-
-		return expr;
+		if (expression_stack.size() == base)
+			return node;
 	}
-	else if (curr_tk->type() == TokenType::T_OPERATOR_SYM)
-	{
-		return operand_n();
-	}
-
-	return nullptr;
 }
 
-std::unique_ptr<LiteralNode> Parser::literal_n(void)
+NodeIndex Parser::literal_n(void)
 {
-	std::unique_ptr<LiteralNode> lit_node { new LiteralNode };
-
+	MathObjType type;
 	switch (curr_tk->type())
 	{
 		case TokenType::T_INTEGER_LITERAL:
-			lit_node->type = MathObjType(MOT::MO_INTEGER);
+			type = MathObjType(MOT::MO_INTEGER);
 			break;
 		case TokenType::T_REAL_LITERAL:
-			lit_node->type = MathObjType(MOT::MO_REAL);
+			type = MathObjType(MOT::MO_REAL);
 			break;
 		
-		default: return nullptr;
+		default: return NO_NODE;
+	}
+
+	// The value is read from the exact lexeme (the source is not null-terminated after it)
+	std::string_view lexeme = curr_tk->lexeme();
+	const char * end = lexeme.data() + lexeme.length();
+	long long integer = 0;
+	double real = 0.0;
+	std::from_chars_result result = type.type == MOT::MO_INTEGER ?
+		std::from_chars(lexeme.data(), end, integer) :
+		std::from_chars(lexeme.data(), end, real);
+	if (result.ec == std::errc::result_out_of_range)
+	{
+		register_syntax_error("number out of range");
+		return NO_NODE;
 	}
 
-	lit_node->value = curr_tk->lexeme();
-	lit_node->line = curr_tk->line();
-	lit_node->column = curr_tk->column();
+	auto [index, lit_node] = ast.make<LiteralNode>();
+	lit_node->type = type;
+	lit_node->value = lexeme;
+	if (type.type == MOT::MO_INTEGER)
+		lit_node->integer = integer;
+	else
+		lit_node->real = real;
+	lit_node->location = curr_tk->position();
 	lit_node->start_position = curr_tk->position();
 	lit_node->end_position = lit_node->start_position + curr_tk->lexeme().length();
-	return lit_node;
+	return index;
 }
 
-std::unique_ptr<IdentifierNode> Parser::identifier_n(void)
+NodeIndex Parser::identifier_n(void)
 {
 	if (curr_tk->type() != TokenType::T_IDENTIFIER)
-		return nullptr;
-	std::unique_ptr<IdentifierNode> id_node {
-		new IdentifierNode(curr_tk->lexeme())
-	};
+		return NO_NODE;
+	auto [index, id_node] = ast.make<IdentifierNode>(curr_tk->lexeme(), curr_tk->symbol());
 
-	id_node->line = curr_tk->line();
-	id_node->column = curr_tk->column();
+	id_node->location = curr_tk->position();
 	id_node->start_position = curr_tk->position();
 	id_node->end_position = id_node->start_position + curr_tk->lexeme().length();
-	return id_node;
+	return index;
 }
 
-std::unique_ptr<OperatorNode> Parser::operator_n(bool unary)
+NodeIndex Parser::operator_n(bool unary)
 {
 	if (curr_tk->type() != TokenType::T_OPERATOR_SYM)
-		return nullptr;
+		return NO_NODE;
 	if (unary && curr_tk->lexeme() == "+")
 	{
 		consume_tk();
-		return nullptr;
+		return NO_NODE;
 	}
 
 	auto op = operators->find(curr_tk->lexeme());
@@ -481,50 +518,47 @@ std::unique_ptr<OperatorNode> Parser::operator_n(bool unary)
 			register_syntax_error("unary operator `" + std::string(curr_tk->lexeme()) + "` is not defined");
 		else
 			register_syntax_error("binary operator `" + std::string(curr_tk->lexeme()) + "` is not defined");
-		return nullptr;
+		return NO_NODE;
 	}
 
-	std::unique_ptr<OperatorNode> op_node {
-		new OperatorNode(op)
-	};
-	op_node->line = curr_tk->line();
-	op_node->column = curr_tk->column();
+	auto [index, op_node] = ast.make<OperatorNode>(op.get());
+	op_node->location = curr_tk->position();
 	op_node->start_position = curr_tk->position();
 	op_node->end_position = op_node->start_position + curr_tk->lexeme().length();
-	return op_node;
+	return index;
 }
 
-std::unique_ptr<TypeNode> Parser::type_n(void)
+NodeIndex Parser::type_n(void)
 {
-	std::unique_ptr<TypeNode> type_node { new TypeNode };
+	MathObjType type;
 
 	if (curr_tk->type() == TokenType::T_CONST)
 	{
-		type_node->type.is_const = true;
+		type.is_const = true;
 		consume_tk();
 	}
 	else
 	{
-		type_node->type.is_const = false;
+		type.is_const = false;
 	}
 
 	switch (curr_tk->type())
 	{
 		case TokenType::T_INTEGER:
-			type_node->type.type = MOT::MO_INTEGER;
+			type.type = MOT::MO_INTEGER;
 			break;
 		case TokenType::T_REAL:
-			type_node->type.type = MOT::MO_REAL;
+			type.type = MOT::MO_REAL;
 			break;
 		case TokenType::T_NONE:
-			type_node->type.type = MOT::MO_NONE;
+			type.type = MOT::MO_NONE;
 			break;
 
 		default:
-			return nullptr;
+			return NO_NODE;
 	}
 
-	return type_node;
+	return ast.make<TypeNode>(type).first;
 }
 
 void Parser::expect_tk(TokenType type, std::string message)
@@ -544,8 +578,6 @@ void Parser::register_syntax_error(std::string message)
 
 		std::unique_ptr<Error> err { new SyntaxError(
 			message,
-			curr_tk->line(),
-			curr_tk->column(),
 			curr_tk->position(),
 			curr_tk->lexeme().length()
 		)};
@@ -568,19 +600,14 @@ void Parser::synchronize(void)
 
 bool Parser::consume_tk(void)
 {
-	if (curr_tk && next_tk)
-	{
-		curr_tk = std::move(next_tk);
-		next_tk = lexer->scan_tk();
-	}
-	else
-	{
-		curr_tk = lexer->scan_tk();
-		next_tk = lexer->scan_tk();
-	}
+	// The EOF token stays the current token once it is reached
+	if (curr_tk && tk_index + 1 < tokens.size())
+		tk_index++;
+	curr_tk = &tokens[tk_index];
+	next_tk = &tokens[std::min(tk_index + 1, tokens.size() - 1)];
 
 	if (config::print_lexer_output)
-		d_print_token(curr_tk);
+		d_print_token(*curr_tk, token_lines->locate(curr_tk->position()).line);
 	
 	if (curr_tk->type() == TokenType::T_ERROR)
 		panic_mode = true;
@@ -0,0 +1,124 @@
+#include <bit>
+#include <cstdint>
+
+#include "scan.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_VECTOR
+
+using Vector = __m256i;
+constexpr ptrdiff_t WIDTH = 32;
+constexpr uint32_t ALL_MEMBERS = 0xFFFFFFFF;
+const char * const INSTRUCTION_SET = "AVX2";
+
+inline Vector load(const char * p) { return _mm256_loadu_si256((const __m256i *)p); }
+inline Vector splat(char c) { return _mm256_set1_epi8(c); }
+inline Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+inline Vector max_unsigned(Vector a, Vector b) { return _mm256_max_epu8(a, b); }
+inline Vector subtract(Vector a, char c) { return _mm256_sub_epi8(a, splat(c)); }
+inline uint32_t members(Vector v) { return (uint32_t)_mm256_movemask_epi8(v); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCAN_VECTOR
+
+using Vector = __m128i;
+constexpr ptrdiff_t WIDTH = 16;
+constexpr uint32_t ALL_MEMBERS = 0xFFFF;
+const char * const INSTRUCTION_SET = "SSE2";
+
+inline Vector load(const char * p) { return _mm_loadu_si128((const __m128i *)p); }
+inline Vector splat(char c) { return _mm_set1_epi8(c); }
+inline Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+inline Vector max_unsigned(Vector a, Vector b) { return _mm_max_epu8(a, b); }
+inline Vector subtract(Vector a, char c) { return _mm_sub_epi8(a, splat(c)); }
+inline uint32_t members(Vector v) { return (uint32_t)_mm_movemask_epi8(v); }
+
+#else
+const char * const INSTRUCTION_SET = "scalar";
+#endif
+
+#ifdef SCAN_VECTOR
+inline Vector equal(Vector a, char c) { return equal(a, splat(c)); }
+
+// lo <= c <= hi (unsigned): c - lo <= hi - lo, i.e. max(c - lo, hi - lo) == hi - lo
+inline Vector in_range(Vector v, char lo, char hi)
+{
+	Vector limit = splat(hi - lo);
+	return equal(max_unsigned(subtract(v, lo), limit), limit);
+}
+#endif
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+inline bool is_word_char(char c) { return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || is_digit(c) || c == '_'; }
+inline bool is_number_char(char c) { return is_digit(c) || c == '.'; }
+inline bool is_line_char(char c) { return c != '\n' && c != '\0'; }
+
+// Length of the prefix of [begin, end) for which `classify` sets the bytes of a vector
+// and `is_member` is true (the vector loop never reads past `end`)
+template <typename Classify, typename IsMember>
+size_t scan_prefix(const char * begin, const char * end, Classify classify, IsMember is_member)
+{
+	const char * p = begin;
+#ifdef SCAN_VECTOR
+	while (end - p >= WIDTH)
+	{
+		uint32_t mask = members(classify(load(p)));
+		if (mask != ALL_MEMBERS)
+			return p - begin + std::countr_one(mask);
+		p += WIDTH;
+	}
+#endif
+	while (p < end && is_member(*p))
+		p++;
+	return p - begin;
+}
+
+size_t scan_blanks(const char * begin, const char * end)
+{
+#ifdef SCAN_VECTOR
+	auto classify = [](Vector v) { return either(either(equal(v, ' '), equal(v, '\t')), equal(v, '\r')); };
+#else
+	auto classify = nullptr;
+#endif
+	return scan_prefix(begin, end, classify, is_blank);
+}
+
+size_t scan_word_chars(const char * begin, const char * end)
+{
+#ifdef SCAN_VECTOR
+	// Setting bit 5 turns upper case letters into lower case ones
+	auto classify = [](Vector v) { return either(either(in_range(either(v, splat(0x20)), 'a', 'z'), in_range(v, '0', '9')), equal(v, '_')); };
+#else
+	auto classify = nullptr;
+#endif
+	return scan_prefix(begin, end, classify, is_word_char);
+}
+
+size_t scan_number_chars(const char * begin, const char * end)
+{
+#ifdef SCAN_VECTOR
+	auto classify = [](Vector v) { return either(in_range(v, '0', '9'), equal(v, '.')); };
+#else
+	auto classify = nullptr;
+#endif
+	return scan_prefix(begin, end, classify, is_number_char);
+}
+
+size_t scan_line(const char * begin, const char * end)
+{
+#ifdef SCAN_VECTOR
+	// Complement of the bytes equal to '\n' or '\0'
+	auto classify = [](Vector v) { return equal(either(equal(v, '\n'), equal(v, '\0')), '\0'); };
+#else
+	auto classify = nullptr;
+#endif
+	return scan_prefix(begin, end, classify, is_line_char);
+}
+
+const char * scan_instruction_set(void)
+{ return INSTRUCTION_SET; }
\ No newline at end of file
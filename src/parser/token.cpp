@@ -1,9 +1,15 @@
+#include <array>
 #include <string>
-#include <unordered_map>
 
 #include "token.h"
 
-std::unordered_map<std::string_view, TokenType> keywords = {
+struct Keyword
+{
+	std::string_view lexeme;
+	TokenType type;
+};
+
+constexpr Keyword keywords[] = {
 	// * A - Z
 	{"Else", TokenType::T_ELSE},
 	{"If", TokenType::T_IF},
@@ -27,25 +33,71 @@ std::unordered_map<std::string_view, TokenType> keywords = {
 	{"use", TokenType::T_USE},
 };
 
+/* Perfect hash of the keywords: the seed is searched at compile time so that
+   no two keywords fall into the same slot, and a lookup is a single comparison.
+*/
+constexpr size_t KEYWORD_TABLE_BITS = 6;
+constexpr size_t KEYWORD_TABLE_SIZE = 1 << KEYWORD_TABLE_BITS;
+
+constexpr size_t keyword_hash(std::string_view word, uint32_t seed)
+{
+	// The length and three characters are enough to tell the keywords apart
+	uint32_t hash = (uint32_t)word.length();
+	hash = hash * 31 + (unsigned char)word.front();
+	hash = hash * 31 + (unsigned char)word[word.length() / 2];
+	hash = hash * 31 + (unsigned char)word.back();
+	// Multiplicative hashing, with an odd multiplier chosen by the seed
+	return (hash * (2654435761u + 2 * seed)) >> (32 - KEYWORD_TABLE_BITS);
+}
+
+constexpr uint32_t find_keyword_seed(void)
+{
+	for (uint32_t seed = 0;; seed++)
+	{
+		bool used[KEYWORD_TABLE_SIZE] {};
+		bool collision = false;
+		for (auto & keyword : keywords)
+		{
+			size_t slot = keyword_hash(keyword.lexeme, seed);
+			collision |= used[slot];
+			used[slot] = true;
+		}
+
+		if (!collision)
+			return seed;
+	}
+}
+constexpr uint32_t KEYWORD_SEED = find_keyword_seed();
+
+constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> make_keyword_table(void)
+{
+	std::array<Keyword, KEYWORD_TABLE_SIZE> table {};
+	for (auto & keyword : keywords)
+		table[keyword_hash(keyword.lexeme, KEYWORD_SEED)] = keyword;
+	return table;
+}
+constexpr auto keyword_table = make_keyword_table();
+
 TokenType check_word_t_type(std::string_view lexeme)
 {
 	if (lexeme.length() == 0)
 		return TokenType::T_ERROR;
-		
-	auto i = keywords.find(lexeme);
-	return i != keywords.end() ?
-		i->second :
+
+	// Empty slots have an empty lexeme, which never matches
+	auto & keyword = keyword_table[keyword_hash(lexeme, KEYWORD_SEED)];
+	return keyword.lexeme == lexeme ?
+		keyword.type :
 		TokenType::T_IDENTIFIER;
 }
 
-bool Token::is_literal(void)
+bool Token::is_literal(void) const
 { return _type_ == TokenType::T_INTEGER_LITERAL ||  _type_ == TokenType::T_REAL_LITERAL; }
 
-bool Token::is_identifier(void)
+bool Token::is_identifier(void) const
 { return _type_ == TokenType::T_IDENTIFIER; }
 
-bool Token::is_operator(void)
+bool Token::is_operator(void) const
 { return _type_ == TokenType::T_OPERATOR_SYM; }
 
-bool Token::is_eof(void)
+bool Token::is_eof(void) const
 { return _type_ == TokenType::T_EOF; }
\ No newline at end of file
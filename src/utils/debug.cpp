@@ -9,8 +9,9 @@
 #include "ast.h"
 #include "compiler.h"
 #include "mathobj.h"
+#include "nametable.h"
 
-std::unordered_map<TokenType, const char *> tk_type_string =
+constexpr std::pair<TokenType, const char *> tk_type_names[] =
 {
 	{ TokenType::T_IDENTIFIER,		"IDENTIFIER   " },
 
@@ -31,11 +32,12 @@ std::unordered_map<TokenType, const char *> tk_type_string =
 	{ TokenType::T_ERROR,			"ERROR        " },
 	{ TokenType::T_EOF,				"EOF          " }
 };
+constexpr auto tk_type_string = make_name_table<TokenType, (size_t)TokenType::T_EOF + 1>(tk_type_names, "KEYWORD	  ");
 
 const char * tk_type_to_string(TokenType t_type)
-{ return tk_type_string.find(t_type) != tk_type_string.end() ? tk_type_string[t_type] : "KEYWORD	  "; }
+{ return tk_type_string[(size_t)t_type]; }
 
-std::unordered_map<uint8_t, const char *> opcode_string =
+constexpr std::pair<OpCode, const char *> opcode_names[] =
 {
 	{ OpCode::OP_LOAD_CONST,	"LOAD_CONST "	},
 
@@ -55,9 +57,34 @@ std::unordered_map<uint8_t, const char *> opcode_string =
 	{ OpCode::OP_RETURN,		"RETURN     "	},
 	{ OpCode::OP_RETURN_VALUE,	"RETURN_VAL "	}
 };
+constexpr auto opcode_string = make_name_table<OpCode, OpCode::OP_RETURN_VALUE + 1>(opcode_names, "UNKNOWN    ");
 
 const char * opcode_to_string(uint8_t opcode)
-{ return opcode_string[opcode]; }
+{ return opcode < opcode_string.size() ? opcode_string[opcode] : "UNKNOWN    "; }
+
+constexpr std::pair<IROpCode, const char *> ir_opcode_names[] =
+{
+	{ IROpCode::I_CONST,			"const"			},
+	{ IROpCode::I_LOAD_VAR,			"load_var"		},
+	{ IROpCode::I_VAR_REF,			"var_ref"		},
+	{ IROpCode::I_ASSIGN,			"assign"		},
+	{ IROpCode::I_SET_VAR,			"set_var"		},
+	{ IROpCode::I_SET_PARAM,		"set_param"		},
+	{ IROpCode::I_UNARY,			"unary"			},
+	{ IROpCode::I_BINARY,			"binary"		},
+	{ IROpCode::I_CALL,				"call"			},
+
+	{ IROpCode::I_ENTER_BLOCK,		"enter_block"	},
+	{ IROpCode::I_LEAVE_BLOCK,		"leave_block"	},
+
+	{ IROpCode::I_RETURN,			"return"		},
+	{ IROpCode::I_RETURN_VALUE,		"return_value"	},
+	{ IROpCode::I_LEAVE_FUNCTION,	"leave_function"}
+};
+constexpr auto ir_opcode_string = make_name_table<IROpCode, (size_t)IROpCode::I_LEAVE_FUNCTION + 1>(ir_opcode_names, "unknown");
+
+const char * ir_opcode_to_string(IROpCode opcode)
+{ return ir_opcode_string[(size_t)opcode]; }
 
 void indent(int depth);
 
@@ -68,6 +95,9 @@ void Compiler::disassemble(void)
 		if (func->type == FunctionType::F_BUILTIN)
 			continue;
 		auto custom_func = std::static_pointer_cast<CustomFunction>(func);
+		// Not called (so not compiled) yet
+		if (!custom_func->chunk)
+			continue;
 		disassemble(custom_func->chunk);
 	}
 	disassemble(chunk);
@@ -76,8 +106,8 @@ void Compiler::disassemble(void)
 void Compiler::disassemble(std::shared_ptr<Chunk> & chunk)
 {
 	std::cout << chunk->name << ":\n";
-	auto & bytes = chunk->bytecode();
-	for (int i = 0; i < bytes.size(); i++)
+	auto bytes = chunk->bytecode();
+	for (size_t i = 0; i < bytes.size(); i++)
 	{
 		std::cout << std::setw(2) << std::setfill('0') << std::hex;
 		std::cout << (int)bytes[i] << " |\t"
@@ -118,6 +148,63 @@ void Compiler::disassemble(std::shared_ptr<Chunk> & chunk)
 	std::cout << '\n';
 }
 
+void Compiler::dump_ir(void)
+{
+	for (auto & function : ir_functions)
+		dump_ir(*function);
+}
+
+void Compiler::dump_ir(const IRFunction & function)
+{
+	std::cout << function.name << ":\n";
+	for (auto & instruction : function.instructions)
+	{
+		std::cout << "    ";
+		if (instruction.has_result())
+			std::cout << '%' << instruction.result << " = ";
+		std::cout << ir_opcode_to_string(instruction.op);
+
+		switch (instruction.op)
+		{
+			case IROpCode::I_CONST:
+				std::cout << ' ' << instruction.constant->to_string();
+				break;
+			case IROpCode::I_LOAD_VAR:
+			case IROpCode::I_VAR_REF:
+			case IROpCode::I_SET_VAR:
+			case IROpCode::I_SET_PARAM:
+				std::cout << ' ';
+				print_variable((*variables)[instruction.index]);
+				break;
+			case IROpCode::I_ASSIGN:
+			case IROpCode::I_UNARY:
+			case IROpCode::I_BINARY:
+				std::cout << " `" << instruction.op_name << '`';
+				break;
+			case IROpCode::I_CALL:
+				std::cout << ' ';
+				print_function((*functions)[instruction.index]);
+				break;
+
+			default:
+				break;
+		}
+
+		for (size_t i = 0; i < instruction.operands.size(); i++)
+			std::cout << (i == 0 ? " " : ", ") << '%' << instruction.operands[i];
+
+		if (instruction.has_result())
+		{
+			std::cout << "\t: ";
+			if (instruction.type.is_const)
+				std::cout << "const ";
+			std::cout << mathobjtype_to_string(instruction.type.type);
+		}
+		std::cout << '\n';
+	}
+	std::cout << '\n';
+}
+
 void Compiler::print_constant(std::shared_ptr<MathObj> & constant)
 {
 	if (constant->type().type == MOT::MO_REAL || constant->type().type == MOT::MO_INTEGER)
@@ -149,164 +236,154 @@ void Compiler::print_operator(std::pair<std::shared_ptr<const OperatorFunction>,
 	std::cout << op.second;
 }
 
-void d_print_token(std::unique_ptr<Token> & token)
+void d_print_token(const Token & token, size_t line)
 {
 	static size_t prev_line = 0;
 	
-	if (prev_line != token->line())
-		std::cout << token->line();
+	if (prev_line != line)
+		std::cout << line;
 	else
 		std::cout << '|';
 
-	std::cout << '\t' << tk_type_to_string(token->type()) << " \t";
-	if (token->lexeme() != "")
-		std::cout << '\"' << token->lexeme() << '\"';
+	std::cout << '\t' << tk_type_to_string(token.type()) << " \t";
+	if (token.lexeme() != "")
+		std::cout << '\"' << token.lexeme() << '\"';
 	std::cout << '\n';
 
-	prev_line = token->line();
+	prev_line = line;
 }
 
 void AST::print(void) const
 {
 	std::cout << "Program :\n";
-	for (auto & stmt : statements)
-		stmt->print(1);
-}
-
-void BlockNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Block :\n";
-	for (auto & stmt : statements)
-		stmt->print(depth + 1);
-}
-
-void ReturnNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Return\n";
-}
-
-void ReturnStatementNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Return Statement :\n";
-	value->print(depth + 1);
+	for (NodeIndex stmt : statements)
+		print(stmt, 1);
 }
 
-void FunctionDeclarationNode::print(int depth) const
+void AST::print(NodeIndex index, int depth) const
 {
 	indent(depth);
-	std::cout << "Function Declaration :\n";
-	name->print(depth + 1);
-	for (auto & param : parameters)
-		param->print(depth + 1);
-	if (return_type)
-		return_type->print(depth + 1);
-	body->print(depth + 1);
-}
-
-void FunctionCallNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Function Call :\n";
-	name->print(depth + 1);
-	if (!arguments.empty())
+	switch (node(index).n_type)
 	{
-		indent(depth + 1);
-		std::cout << "Arguments :\n";
-		for (auto & arg : arguments)
-			arg->print(depth + 2);
-	}
-}
-
-void ParameterNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Parameter :\n";
-	name->print(depth + 1);
-	type->print(depth + 1);
-	if (default_value)
-		default_value->print(depth + 1);
-}
-
-void VariableDeclarationNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Variable Declaration :\n";
-	type->print(depth + 1);
-	name->print(depth + 1);
-	if (value)
-		value->print(depth + 1);
-}
-
-void ExpressionStatementNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Expression Statement :\n";
-	for (auto & expr : expressions)
-		expr->print(depth + 1);
-}
-
-void ExpressionNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Expression :\n";
-
-	op->print(depth + 1);
-	left->print(depth + 1);
-	right->print(depth + 1);
-}
-
-void OperandNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Operand :\n";
-
-	if (op)
-		op->print(depth + 1);
+		case NodeType::N_BLOCK:
+		{
+			std::cout << "Block :\n";
+			for (NodeIndex stmt : list(get<BlockNode>(index).statements))
+				print(stmt, depth + 1);
+			break;
+		}
+		case NodeType::N_RETURN:
+			std::cout << "Return\n";
+			break;
+		case NodeType::N_RETURN_STMT:
+			std::cout << "Return Statement :\n";
+			print(get<ReturnStatementNode>(index).value, depth + 1);
+			break;
+		case NodeType::N_FUNC_DECL:
+		{
+			auto & func_decl = get<FunctionDeclarationNode>(index);
+			std::cout << "Function Declaration :\n";
+			print(func_decl.name, depth + 1);
+			for (NodeIndex param : list(func_decl.parameters))
+				print(param, depth + 1);
+			if (func_decl.return_type != NO_NODE)
+				print(func_decl.return_type, depth + 1);
+			print(func_decl.body, depth + 1);
+			break;
+		}
+		case NodeType::N_FUNC_CALL:
+		{
+			auto & func_call = get<FunctionCallNode>(index);
+			std::cout << "Function Call :\n";
+			print(func_call.name, depth + 1);
+			if (func_call.arguments.size != 0)
+			{
+				indent(depth + 1);
+				std::cout << "Arguments :\n";
+				for (NodeIndex arg : list(func_call.arguments))
+					print(arg, depth + 2);
+			}
+			break;
+		}
+		case NodeType::N_PARAMETER:
+		{
+			auto & param = get<ParameterNode>(index);
+			std::cout << "Parameter :\n";
+			print(param.name, depth + 1);
+			print(param.type, depth + 1);
+			if (param.default_value != NO_NODE)
+				print(param.default_value, depth + 1);
+			break;
+		}
+		case NodeType::N_VAR_DECL:
+		{
+			auto & var_decl = get<VariableDeclarationNode>(index);
+			std::cout << "Variable Declaration :\n";
+			print(var_decl.type, depth + 1);
+			print(var_decl.name, depth + 1);
+			if (var_decl.value != NO_NODE)
+				print(var_decl.value, depth + 1);
+			break;
+		}
+		case NodeType::N_EXPR_STMT:
+		{
+			std::cout << "Expression Statement :\n";
+			for (NodeIndex expr : list(get<ExpressionStatementNode>(index).expressions))
+				print(expr, depth + 1);
+			break;
+		}
+		case NodeType::N_EXPR:
+		{
+			auto & expr = get<ExpressionNode>(index);
+			std::cout << "Expression :\n";
 
-	if (primary)
-		primary->print(depth + 1);
-	else
-	{
-		indent(depth + 1);
-		std::cout << "ERROR\n";
+			print(expr.op, depth + 1);
+			print(expr.left, depth + 1);
+			print(expr.right, depth + 1);
+			break;
+		}
+		case NodeType::N_OPERAND:
+		{
+			auto & operand = get<OperandNode>(index);
+			std::cout << "Operand :\n";
+
+			if (operand.op != NO_NODE)
+				print(operand.op, depth + 1);
+
+			if (operand.primary != NO_NODE)
+				print(operand.primary, depth + 1);
+			else
+			{
+				indent(depth + 1);
+				std::cout << "ERROR\n";
+			}
+			break;
+		}
+		case NodeType::N_LITERAL:
+			std::cout << "Literal : " << get<LiteralNode>(index).value << '\n';
+			break;
+		case NodeType::N_IDENTIFIER:
+			std::cout << "Identifier : " << get<IdentifierNode>(index).name << '\n';
+			break;
+		case NodeType::N_OPERATOR:
+			std::cout << "Operator : " << get<OperatorNode>(index).op_info->name << '\n';
+			break;
+		case NodeType::N_TYPE:
+			std::cout << "Type : ";
+			//std::visit([&](auto & type) {
+			//	using T = std::decay_t<decltype(type)>;
+			//	if constexpr (std::is_same_v<T, MOT>)
+			//		std::cout << type_to_string[type] <<'\n';
+			//	else if constexpr (std::is_same_v<T, std::unique_ptr<IdentifierNode>>)
+			//		std::cout << type->name << '\n';
+			//}, type);
+			std::cout << '\n';
+			break;
+
+		default: break;
 	}
 }
 
-void LiteralNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Literal : " << value << '\n';
-}
-
-void IdentifierNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Identifier : " << name << '\n';
-}
-
-void OperatorNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Operator : " << op_info->name << '\n';
-}
-
-void TypeNode::print(int depth) const
-{
-	indent(depth);
-	std::cout << "Type : ";
-	//std::visit([&](auto & type) {
-	//	using T = std::decay_t<decltype(type)>;
-	//	if constexpr (std::is_same_v<T, MOT>)
-	//		std::cout << type_to_string[type] <<'\n';
-	//	else if constexpr (std::is_same_v<T, std::unique_ptr<IdentifierNode>>)
-	//		std::cout << type->name << '\n';
-	//}, type);
-	std::cout << '\n';
-}
-
 void indent(int depth)
 {
 	for (int i = 0; i < depth; i++)
@@ -1,17 +1,16 @@
 #include <iostream>
-#include <unordered_map>
 
 #include "error.h"
+#include "nametable.h"
 #include "globals.h"
 #include "lexer.h"
+#include "lineindex.h"
 
-std::vector<std::unique_ptr<Error>> ErrorHandler::errors;
+thread_local std::vector<std::unique_ptr<Error>> ErrorHandler::errors;
 
-void report_error(std::unique_ptr<Error> & err, std::string_view source);
-size_t find_previous_line_start(std::string_view source, size_t start_from);
-size_t find_next_line_end(std::string_view source, size_t start_from);
+void report_error(std::unique_ptr<Error> & err, const LineIndex & lines, size_t first_line);
 
-std::unordered_map<ErrorType, const char *> error_type_string =
+constexpr std::pair<ErrorType, const char *> error_type_names[] =
 {
 	{ ErrorType::LEXICAL_ERR,		"LEXICAL_ERROR"		},
 	{ ErrorType::SYNTAX_ERR,		"SYNTAX_ERROR"		},
@@ -19,37 +18,46 @@ std::unordered_map<ErrorType, const char *> error_type_string =
 	{ ErrorType::COMPILE_ERR,		"COMPILATION_ERROR" },
 	{ ErrorType::RUNTIME_ERR,		"RUNTIME_ERROR"		}
 };
+constexpr auto error_type_string = make_name_table<ErrorType, (size_t)ErrorType::RUNTIME_ERR + 1>(error_type_names, "ERROR");
 
 const char * error_type_to_string(ErrorType type)
-{ return error_type_string[type]; }
+{ return error_type_string[(size_t)type]; }
 
-void ErrorHandler::report_errors(std::string_view source)
+void ErrorHandler::report_errors(std::string_view source, size_t first_line)
 {
+	// Lines are only indexed when there is something to report, and once for all the errors
+	if (errors.empty())
+		return;
+	LineIndex lines(source);
 	for (auto e = errors.begin(); e != errors.end(); e++)
-		report_error(*e, source);
+		report_error(*e, lines, first_line);
 
 	errors.clear();
 }
 
-void report_error(std::unique_ptr<Error> & err, std::string_view source)
+void report_error(std::unique_ptr<Error> & err, const LineIndex & lines, size_t first_line)
 {
-	std::string_view additional_info = err->get_additional_info();
+	std::string additional_info = err->get_additional_info();
+	LineIndex::Location location = lines.locate(err->position());
 
 	std::cerr << "[error] " << file_name << ": "
-		<< "line " << err->line()
-		<< ", column " << err->column() << "\n"
+		<< "line " << location.line + first_line - 1
+		<< ", column " << location.column << "\n"
 		<< error_type_to_string(err->type()) << ": "
 		<< err->message();
 	if (additional_info != "")
 		std::cerr << " : " << additional_info;
 
-	size_t line_start = find_previous_line_start(source, err->position()) + 1;
-	size_t line_end = find_next_line_end(source, err->position());
-	
-	std::string_view error_line = source.substr(line_start, line_end - line_start);
+	// Tabs are printed as spaces so the caret lines up with the column
+	std::string error_line;
+	for (char c : lines.line_text(location.line))
+		if (c == '\t')
+			error_line.append(TAB_WIDTH, ' ');
+		else
+			error_line += c;
 	std::cerr << "\n\n" << error_line << '\n';
 
-	size_t num_spaces = err->column() - 1;
+	size_t num_spaces = location.column - 1;
 	std::cerr << std::string(num_spaces, ' ') << '^';
 	auto err_len = err->length();
 	if (err_len > 0)
@@ -57,23 +65,24 @@ void report_error(std::unique_ptr<Error> & err, std::string_view source)
 	std::cout << std::endl;
 }
 
+void ErrorHandler::discard_errors(void)
+{ errors.clear(); }
+
 void ErrorHandler::push_error(std::unique_ptr<Error> & err)
 { errors.push_back(std::move(err)); }
 
-bool ErrorHandler::has_errors(void)
-{ return !errors.empty(); }
-
-size_t find_previous_line_start(std::string_view source, size_t start_from)
+std::vector<std::unique_ptr<Error>> ErrorHandler::take_errors(void)
 {
-	size_t i;
-	for (i = start_from; i > 0 && source[i] != '\n'; --i);
-	if (i == 0)
-		return -1;
-	return i;
+	std::vector<std::unique_ptr<Error>> taken;
+	taken.swap(errors);
+	return taken;
 }
-size_t find_next_line_end(std::string_view source, size_t start_from)
+
+void ErrorHandler::push_errors(std::vector<std::unique_ptr<Error>> errors)
 {
-	size_t i;
-	for (i = start_from; i < source.length() && source[i] != '\n'; ++i);
-	return i;
-}
\ No newline at end of file
+	for (auto & err : errors)
+		ErrorHandler::errors.push_back(std::move(err));
+}
+
+bool ErrorHandler::has_errors(void)
+{ return !errors.empty(); }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <cstring>
+
+#include "lineindex.h"
+
+LineIndex::LineIndex(std::string_view source) :
+	source(source)
+{
+	// memchr skips to the next '\n' a vector at a time
+	line_starts.push_back(0);
+	const char * begin = source.data(), * end = begin + source.length();
+	for (const char * p = begin; (p = (const char *)std::memchr(p, '\n', end - p)) != nullptr; p++)
+		line_starts.push_back((uint32_t)(p + 1 - begin));
+}
+
+LineIndex::Location LineIndex::locate(size_t position) const
+{
+	// The line is the last one starting at or before `position`
+	auto next_line = std::upper_bound(line_starts.begin(), line_starts.end(), position);
+	size_t line = next_line - line_starts.begin();
+	size_t line_start = line_starts[line - 1];
+
+	position = std::min(position, source.length());
+	auto tabs = std::count(source.begin() + line_start, source.begin() + position, '\t');
+	return { line, position - line_start + (TAB_WIDTH - 1) * tabs + 1 };
+}
+
+std::string_view LineIndex::line_text(size_t line) const
+{
+	size_t start = line_starts[line - 1];
+	size_t end = line < line_starts.size() ? line_starts[line] - 1 : source.length();
+	return source.substr(start, end - start);
+}
\ No newline at end of file
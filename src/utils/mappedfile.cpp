@@ -0,0 +1,70 @@
+#include <ios>
+
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string & path)
+{
+	std::ifstream file { path, std::ios::binary };
+	if (!file.is_open())
+		throw std::ios_base::failure("unable to open file `" + path + '`');
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	buffer = contents.str();
+	data = buffer.data();
+	size = buffer.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+MappedFile::MappedFile(const std::string & path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::ios_base::failure("unable to open file `" + path + '`');
+
+	struct stat info;
+	if (fstat(fd, &info) < 0)
+	{
+		close(fd);
+		throw std::ios_base::failure("unable to read file `" + path + '`');
+	}
+
+	// An empty file cannot be mapped, it is left as an empty view
+	size = (size_t)info.st_size;
+	if (size > 0)
+	{
+		void * mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			close(fd);
+			throw std::ios_base::failure("unable to map file `" + path + '`');
+		}
+		// The source is read once from start to end
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = (const char *)mapping;
+	}
+	close(fd); // The mapping keeps its own reference to the file
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != nullptr)
+		munmap((void *)data, size);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "symbol.h"
+
+SymbolId SymbolTable::intern(std::string_view name)
+{
+	auto it = symbols.find(name);
+	if (it != symbols.end())
+		return it->second;
+
+	SymbolId symbol = names.size();
+	names.emplace_back(name);
+	symbols.emplace(names.back(), symbol);
+	return symbol;
+}
+
+SymbolId SymbolTable::intern_signature(SymbolId name, std::span<const MOT> parameter_types)
+{
+	std::string key(reinterpret_cast<const char *>(&name), sizeof(name));
+	for (MOT type : parameter_types)
+		key.append(reinterpret_cast<const char *>(&type), sizeof(type));
+
+	auto [it, inserted] = signatures.emplace(std::move(key), signature_count);
+	if (inserted)
+		signature_count++;
+	return it->second;
+}
\ No newline at end of file
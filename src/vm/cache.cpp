@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cache.h"
+#include "image.h"
+
+namespace fs = std::filesystem;
+
+// Temporary files left by an interrupted write are removed after this long
+constexpr auto STALE_AFTER = std::chrono::hours(1);
+
+// 128-bit hash of the bytes (two independent 64-bit lanes, which is plenty for a cache)
+static void hash_bytes(std::string_view bytes, uint64_t & a, uint64_t & b)
+{
+	for (unsigned char c : bytes)
+	{
+		a = (a ^ c) * 0x100000001b3ULL; // FNV-1a
+		b = (b + c) * 0x9e3779b97f4a7c15ULL;
+		b ^= b >> 29;
+	}
+}
+
+fs::path ProgramCache::default_directory(void)
+{
+	if (const char * directory = std::getenv("MATHLANG_CACHE_DIR"); directory && *directory)
+		return directory;
+	if (const char * cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home)
+		return fs::path(cache_home) / "mathlang";
+	if (const char * home = std::getenv("HOME"); home && *home)
+		return fs::path(home) / ".cache" / "mathlang";
+	return {};
+}
+
+fs::path ProgramCache::entry(std::string_view source, std::string_view salt) const
+{
+	uint64_t a = 0xcbf29ce484222325ULL, b = 0x84222325cbf29ce4ULL;
+	hash_bytes(salt, a, b);
+	hash_bytes(std::string_view("\0", 1), a, b);
+	hash_bytes(source, a, b);
+
+	char name[33];
+	std::snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)a, (unsigned long long)b);
+	return directory / (std::string(name) + IMAGE_EXTENSION);
+}
+
+void ProgramCache::touch(const fs::path & entry) const
+{
+	std::error_code error;
+	fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+}
+
+void ProgramCache::store(const fs::path & entry, std::string_view image) const
+{
+	std::error_code error;
+	fs::create_directories(directory, error);
+	if (error)
+		return;
+
+	// Written next to the entry and renamed over it, so readers never see a partial entry
+	fs::path temporary = entry;
+	temporary += "." + std::to_string(getpid()) + ".tmp";
+	{
+		std::ofstream out { temporary, std::ios::binary };
+		out.write(image.data(), image.size());
+		if (!out)
+		{
+			out.close();
+			fs::remove(temporary, error);
+			return;
+		}
+	}
+	fs::rename(temporary, entry, error);
+	if (error)
+	{
+		fs::remove(temporary, error);
+		return;
+	}
+
+	evict();
+}
+
+void ProgramCache::remove(const fs::path & entry) const
+{
+	std::error_code error;
+	fs::remove(entry, error);
+}
+
+void ProgramCache::evict(void) const
+{
+	struct Entry
+	{
+		fs::path path;
+		fs::file_time_type last_use;
+		uintmax_t size;
+	};
+	std::vector<Entry> entries;
+	uintmax_t total_size = 0;
+	auto now = fs::file_time_type::clock::now();
+
+	std::error_code error;
+	for (auto & file : fs::directory_iterator(directory, error))
+	{
+		std::error_code file_error;
+		auto last_use = file.last_write_time(file_error);
+		auto size = file.file_size(file_error);
+		if (file_error)
+			continue;
+
+		if (file.path().extension() == ".tmp")
+		{
+			if (now - last_use > STALE_AFTER)
+				fs::remove(file.path(), file_error);
+		}
+		else if (file.path().extension() == IMAGE_EXTENSION)
+		{
+			entries.push_back({ file.path(), last_use, size });
+			total_size += size;
+		}
+	}
+	if (total_size <= CAPACITY)
+		return;
+
+	// Least recently used first (another process may be evicting the same entries)
+	std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) { return a.last_use < b.last_use; });
+	for (auto & entry : entries)
+	{
+		if (total_size <= CAPACITY)
+			break;
+		fs::remove(entry.path, error);
+		total_size -= entry.size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "image.h"
+#include "compiler.h"
+
+/*
+	Layout (integers are little-endian, strings are a u32 length and their bytes):
+		"MTHLC\0" u16 version
+		constants	u32 count, { i8 type, u64 value (bits of a real) }
+		variables	u32 count, { str name, i8 type, u8 constness }
+		operators	u32 count, { str name, u8 unary, i8 type, i8 type }
+		functions	u32 count, { str name, i8 return type, u8 purity,
+									u32 count, { str name, i8 type, u8 constness },
+									scope, u32 length, bytecode }
+		globals		u32 count, { u8 variable index }, u32 count, { u8 function index }
+		main		scope, u32 length, bytecode
+		snapshot	u8 present, and if it is: u32 count, { u8 set, and if it is: i8 type, u64 value }, str output
+	and a scope is its number of child scopes followed by the children (a snapshot has the values
+	of all the variables, and its main chunk only returns)
+*/
+
+constexpr char IMAGE_MAGIC[6] = "MTHLC";
+
+namespace
+{
+
+[[noreturn]] void invalid_image(void)
+{ throw std::runtime_error("invalid compiled program"); }
+
+class ImageWriter
+{
+public:
+	void u8(uint8_t value) { bytes.push_back((char)value); }
+	void u16(uint16_t value) { integer(value, 2); }
+	void u32(uint32_t value) { integer(value, 4); }
+	void u64(uint64_t value) { integer(value, 8); }
+	void type(const MathObjType & type) { u8((uint8_t)(int8_t)type.type); }
+	void string(std::string_view text) { u32(text.length()); bytes.append(text); }
+	void code(std::span<const uint8_t> code) { u32(code.size()); bytes.append((const char *)code.data(), code.size()); }
+
+	void scope(const Scope & scope)
+	{
+		u32(scope.children.size());
+		for (auto & child : scope.children)
+			this->scope(*child);
+	}
+
+	std::string bytes;
+
+private:
+	void integer(uint64_t value, int size)
+	{
+		for (int i = 0; i < size; i++)
+			u8((uint8_t)(value >> (8 * i)));
+	}
+};
+
+class ImageReader
+{
+public:
+	ImageReader(std::string_view image) : image(image) {}
+
+	uint8_t u8(void) { return (uint8_t)*take(1); }
+	uint16_t u16(void) { return (uint16_t)integer(2); }
+	uint32_t u32(void) { return (uint32_t)integer(4); }
+	uint64_t u64(void) { return integer(8); }
+	MathObjType type(void) { return MathObjType((MOT)(int8_t)u8()); }
+	MathObjType type_and_constness(void)
+	{
+		MathObjType result = type();
+		result.is_const = u8() != 0;
+		return result;
+	}
+	std::string_view string(void)
+	{
+		uint32_t length = u32();
+		return { take(length), length };
+	}
+	std::span<const uint8_t> code(void)
+	{
+		uint32_t length = u32();
+		return { (const uint8_t *)take(length), length };
+	}
+	// Number of entries of a table, or of child scopes (the compiler stops at 255 of them)
+	uint32_t count(void)
+	{
+		uint32_t count = u32();
+		if (count > UINT8_MAX)
+			invalid_image();
+		return count;
+	}
+
+	void scope(const std::shared_ptr<Scope> & scope, size_t depth = 0)
+	{
+		if (depth > MAX_IMAGE_SCOPE_DEPTH)
+			invalid_image();
+		uint32_t children = count();
+		for (uint32_t i = 0; i < children; i++)
+		{
+			std::shared_ptr<Scope> child = std::make_shared<Scope>();
+			child->parent = scope;
+			this->scope(child, depth + 1);
+			scope->children.push_back(child);
+		}
+	}
+
+	bool at_end(void) const { return position == image.length(); }
+
+	const char * take(size_t length)
+	{
+		if (length > image.length() - position)
+			throw std::runtime_error("truncated compiled program");
+		const char * data = image.data() + position;
+		position += length;
+		return data;
+	}
+
+private:
+	std::string_view image;
+	size_t position = 0;
+
+	uint64_t integer(int size)
+	{
+		const char * data = take(size);
+		uint64_t value = 0;
+		for (int i = 0; i < size; i++)
+			value |= (uint64_t)(uint8_t)data[i] << (8 * i);
+		return value;
+	}
+};
+
+bool is_number(const MathObjType & type)
+{ return type.type == MOT::MO_INTEGER || type.type == MOT::MO_REAL; }
+
+// Checks that running a chunk stays inside its bytecode, the tables of the session and the stack.
+// There are no jumps, so a chunk runs from its start to its first return: every instruction must
+// be known, with its operand in the table it indexes (an operator of the right arity), the stack
+// must hold the values it pops, numbers where numbers are used (a call of a function without a
+// result leaves an empty value), and each block it enters must be a child scope. The chunk must
+// end with a return: OP_RETURN for the main chunk (`function` is null), which has no caller, and
+// OP_RETURN_VALUE for a function with a result. A function starts with its arguments on the stack
+void verify_chunk(std::span<const uint8_t> code, const Session & session, const std::vector<bool> & unary_operators,
+	const Scope & scope, const Function * function)
+{
+	std::vector<bool> stack; // Whether each value is a number
+	if (function)
+		stack.assign(function->parameters.size(), true);
+	auto pop = [&](bool number)
+	{
+		if (stack.empty() || (number && !stack.back()))
+			invalid_image();
+		stack.pop_back();
+	};
+
+	std::vector<std::pair<const Scope *, size_t>> blocks { { &scope, 0 } }; // Scopes entered, and the next child of each
+	bool returned = false; // The instructions after a return are not run
+	uint8_t last = UINT8_MAX;
+	for (size_t i = 0; i < code.size();)
+	{
+		uint8_t op = code[i++];
+		size_t table; // Size of the table indexed by the operand (if the instruction has one)
+		switch (op)
+		{
+			case OpCode::OP_LOAD_CONST:
+				table = session.constants->size();
+				break;
+			case OpCode::OP_SET_VAR:
+			case OpCode::OP_LOAD_VAR:
+				table = session.variables->size();
+				break;
+			case OpCode::OP_CALL_FUNCTION:
+				table = session.functions->size();
+				break;
+			case OpCode::OP_UNARY_OP:
+			case OpCode::OP_BINARY_OP:
+				table = session.operators->size();
+				break;
+			default:
+				if (op > OpCode::OP_RETURN_VALUE)
+					invalid_image();
+				table = SIZE_MAX;
+				break;
+		}
+		uint8_t operand = 0;
+		if (table != SIZE_MAX)
+		{
+			if (i == code.size() || code[i] >= table)
+				invalid_image();
+			operand = code[i++];
+		}
+		last = op;
+		if (returned)
+			continue;
+
+		switch (op)
+		{
+			case OpCode::OP_LOAD_CONST:
+				stack.push_back(true);
+				break;
+			case OpCode::OP_LOAD_VAR:
+				stack.push_back(is_number((*session.variables)[operand]->value_type()));
+				break;
+			case OpCode::OP_SET_VAR:
+				pop(true);
+				break;
+			case OpCode::OP_POP:
+				pop(false);
+				break;
+
+			case OpCode::OP_UNARY_OP:
+			case OpCode::OP_BINARY_OP:
+			{
+				bool unary = op == OpCode::OP_UNARY_OP;
+				if (unary_operators[operand] != unary)
+					invalid_image();
+				auto & implementation = (*session.operators)[operand].first;
+				pop(is_number(implementation->arg_types.first));
+				if (!unary)
+					pop(is_number(implementation->arg_types.second));
+				stack.push_back(is_number(implementation->return_type));
+				break;
+			}
+			case OpCode::OP_CALL_FUNCTION:
+			{
+				// The arguments are popped by the function, which leaves its result
+				auto & callee = (*session.functions)[operand];
+				for (size_t j = 0; j < callee->parameters.size(); j++)
+					pop(true);
+				stack.push_back(is_number(callee->return_type));
+				break;
+			}
+
+			case OpCode::OP_ENTER_BLOCK:
+			{
+				auto & [current, next] = blocks.back();
+				if (next == current->children.size())
+					invalid_image();
+				blocks.push_back({ current->children[next++].get(), 0 });
+				break;
+			}
+			case OpCode::OP_LEAVE_BLOCK:
+				if (blocks.size() == 1)
+					invalid_image();
+				blocks.pop_back();
+				break;
+
+			case OpCode::OP_RETURN:
+			case OpCode::OP_LEAVE_FUNCTION:
+				if (op == OpCode::OP_LEAVE_FUNCTION && !function)
+					invalid_image();
+				if (function && is_number(function->return_type))
+					invalid_image();
+				returned = true;
+				break;
+			case OpCode::OP_RETURN_VALUE:
+				if (!function)
+					invalid_image();
+				pop(true);
+				returned = true;
+				break;
+		}
+	}
+
+	if (!returned || (!function && last != OpCode::OP_RETURN))
+		invalid_image();
+}
+}
+
+void write_image(std::ostream & out, const Session & session, const Chunk & main, const Scope & global_scope,
+	const std::string * printed)
+{
+	ImageWriter writer;
+	writer.bytes.append(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	writer.u16(IMAGE_VERSION);
+
+	writer.u32(session.constants->size());
+	for (auto & constant : *session.constants)
+	{
+		ConstantKey key = constant_key(constant);
+		writer.type(key.type);
+		writer.u64(key.bits);
+	}
+
+	writer.u32(session.variables->size());
+	for (auto & variable : *session.variables)
+	{
+		writer.string(variable->name);
+		writer.type(variable->value_type());
+		writer.u8(variable->value_type().is_const);
+	}
+
+	// Operators are found again by name and operand types in the table of the loading session
+	writer.u32(session.operators->size());
+	for (auto & [function, name] : *session.operators)
+	{
+		bool unary = false;
+		auto [begin, end] = session.operator_table->get_implementations(name, true);
+		for (auto it = begin; it != end; it++)
+			unary |= it->second == function;
+
+		writer.string(name);
+		writer.u8(unary);
+		writer.type(function->arg_types.first);
+		writer.type(function->arg_types.second);
+	}
+
+	writer.u32(session.functions->size());
+	for (auto & function : *session.functions)
+	{
+		if (function->type != FunctionType::F_CUSTOM)
+			throw std::runtime_error("builtin functions not implemented");
+		auto custom_function = std::static_pointer_cast<CustomFunction>(function);
+		if (!custom_function->chunk)
+			// just in case of a bug
+			throw std::logic_error("function `" + function->name + "` is not compiled");
+
+		writer.string(function->name);
+		writer.type(function->return_type);
+		writer.u8(custom_function->is_pure);
+		writer.u32(function->parameters.size());
+		for (auto & [name, type] : function->parameters)
+		{
+			writer.string(name);
+			writer.type(type);
+			writer.u8(type.is_const);
+		}
+		writer.scope(*custom_function->scope);
+		writer.code(custom_function->chunk->bytecode());
+	}
+
+	// Names declared in the global scope, so that more source can be compiled against the image
+	// (sorted to keep the image the same from one compilation to the next)
+	std::vector<uint8_t> indices;
+	for (auto & [name, index] : global_scope.variable_indices)
+		indices.push_back(index);
+	std::sort(indices.begin(), indices.end());
+	writer.u32(indices.size());
+	for (uint8_t index : indices)
+		writer.u8(index);
+
+	indices.clear();
+	for (auto & [signature, index] : global_scope.function_indices)
+		indices.push_back(index);
+	std::sort(indices.begin(), indices.end()); // Order of declaration
+	writer.u32(indices.size());
+	for (uint8_t index : indices)
+		writer.u8(index);
+
+	writer.scope(global_scope);
+	writer.code(main.bytecode());
+
+	writer.u8(printed != nullptr);
+	if (printed)
+	{
+		writer.u32(session.variables->size());
+		for (auto & variable : *session.variables)
+		{
+			// Variables hold numbers or none (a variable that was never set holds nothing)
+			writer.u8(variable->value != nullptr);
+			if (!variable->value)
+				continue;
+			auto & value = variable->value;
+			writer.type(value->type());
+			if (value->type().type == MOT::MO_INTEGER)
+				writer.u64((uint64_t)value->as<Integer>()->value());
+			else if (value->type().type == MOT::MO_REAL)
+				writer.u64(std::bit_cast<uint64_t>(value->as<Real>()->value()));
+			else if (value->type().type == MOT::MO_NONE)
+				writer.u64(0);
+			else
+				// just in case of a bug
+				throw std::logic_error("variable `" + variable->name + "` cannot be saved");
+		}
+		writer.string(*printed);
+	}
+
+	out.write(writer.bytes.data(), writer.bytes.size());
+}
+
+std::shared_ptr<Chunk> load_image(std::string_view image, Session & session, const std::shared_ptr<Scope> & global_scope,
+	std::string_view & printed)
+{
+	ImageReader reader(image);
+	if (std::memcmp(reader.take(sizeof(IMAGE_MAGIC)), IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0)
+		throw std::runtime_error("not a compiled MathLang program");
+	uint16_t version = reader.u16();
+	if (version != IMAGE_VERSION)
+		throw std::runtime_error("compiled program of version " + std::to_string(version) + " (expected " + std::to_string(IMAGE_VERSION) + ')');
+
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		MathObjType type = reader.type();
+		uint64_t bits = reader.u64();
+		if (type.type == MOT::MO_INTEGER)
+			session.constants->push_back(std::make_shared<Integer>((long long)bits));
+		else if (type.type == MOT::MO_REAL)
+			session.constants->push_back(std::make_shared<Real>(std::bit_cast<double>(bits)));
+		else
+			throw std::runtime_error("invalid constant in compiled program");
+		session.constant_indices[ConstantKey { type.type, bits }] = session.constants->size() - 1;
+	}
+
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		std::string_view name = reader.string();
+		session.variables->push_back(std::make_shared<Variable>(name, reader.type_and_constness()));
+	}
+
+	std::vector<bool> unary_operators;
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		std::string name(reader.string());
+		bool unary = reader.u8() != 0;
+		unary_operators.push_back(unary);
+		MathObjType first = reader.type();
+		MathObjType second = reader.type();
+
+		auto function = session.operator_table->find_implementation(name, { first, second }, unary);
+		if (!function)
+			throw std::runtime_error("unknown operator `" + name + "` in compiled program");
+		session.operators->push_back(std::make_pair(function, name));
+		session.operator_indices[function.get()] = session.operators->size() - 1;
+	}
+
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		std::string_view name = reader.string();
+		MathObjType return_type = reader.type();
+		auto function = std::make_shared<CustomFunction>(name, return_type);
+		function->is_pure = reader.u8() != 0;
+		for (uint32_t parameters = reader.count(); parameters > 0; parameters--)
+		{
+			std::string parameter(reader.string());
+			function->parameters.push_back(std::make_pair(parameter, reader.type_and_constness()));
+		}
+
+		function->scope = std::make_shared<Scope>();
+		function->scope->is_function_scope = true;
+		reader.scope(function->scope);
+		function->chunk = std::make_shared<Chunk>(name);
+		function->chunk->mapped = reader.code();
+		session.functions->push_back(function);
+	}
+
+	auto & symbols = *session.symbols;
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		uint8_t index = reader.u8();
+		if (index >= session.variables->size())
+			invalid_image();
+		auto & variable = (*session.variables)[index];
+		SymbolId name = symbols.intern(variable->name);
+		global_scope->variables[name] = variable;
+		global_scope->variable_indices[name] = index;
+	}
+	for (uint32_t count = reader.count(); count > 0; count--)
+	{
+		uint8_t index = reader.u8();
+		if (index >= session.functions->size())
+			invalid_image();
+		auto & function = (*session.functions)[index];
+		std::vector<MOT> parameter_types;
+		for (auto & [name, type] : function->parameters)
+			parameter_types.push_back(type.type);
+		SymbolId name = symbols.intern(function->name);
+		function->signature = symbols.intern_signature(name, parameter_types);
+		global_scope->function_table.register_function(name, function);
+		global_scope->function_indices[function->signature] = index;
+	}
+
+	reader.scope(global_scope);
+	auto main = std::make_shared<Chunk>("<main>");
+	main->mapped = reader.code();
+
+	// The bytecode is run as it is, so it must only index the tables loaded above
+	for (auto & function : *session.functions)
+	{
+		auto custom_function = std::static_pointer_cast<CustomFunction>(function);
+		verify_chunk(custom_function->chunk->mapped, session, unary_operators, *custom_function->scope, function.get());
+	}
+	verify_chunk(main->mapped, session, unary_operators, *global_scope, nullptr);
+
+	printed = {};
+	if (reader.u8() != 0)
+	{
+		if (reader.u32() != session.variables->size())
+			invalid_image();
+		for (auto & variable : *session.variables)
+		{
+			if (reader.u8() == 0)
+				continue;
+			MathObjType type = reader.type();
+			uint64_t bits = reader.u64();
+			if (type.type == MOT::MO_INTEGER)
+				variable->value = std::make_shared<Integer>((long long)bits);
+			else if (type.type == MOT::MO_REAL)
+				variable->value = std::make_shared<Real>(std::bit_cast<double>(bits));
+			else if (type.type == MOT::MO_NONE)
+				variable->value = std::make_shared<None>();
+			else
+				throw std::runtime_error("invalid value in compiled program");
+		}
+		printed = reader.string();
+	}
+	if (!reader.at_end())
+		invalid_image();
+	return main;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include <cstring>
+
+#include "output.h"
+#include "mathobj.h"
+
+OutputBuffer * OutputBuffer::active = nullptr;
+
+OutputBuffer::OutputBuffer(std::ostream & stream) :
+	stream(stream),
+	buffer(new char[CAPACITY])
+{}
+
+OutputBuffer::~OutputBuffer()
+{
+	flush();
+	if (active == this)
+		active = nullptr;
+}
+
+void OutputBuffer::reserve(size_t length)
+{
+	if (size + length > CAPACITY)
+		flush();
+}
+
+void OutputBuffer::write(std::string_view text)
+{
+	reserve(text.length());
+	// Text longer than the whole buffer is written through
+	if (text.length() > CAPACITY)
+	{
+		stream.write(text.data(), text.length());
+		return;
+	}
+	std::memcpy(buffer.get() + size, text.data(), text.length());
+	size += text.length();
+}
+
+void OutputBuffer::write_integer(long long value)
+{
+	reserve(NUMBER_CHARS);
+	size = format_integer(buffer.get() + size, value) - buffer.get();
+}
+
+void OutputBuffer::write_real(double value)
+{
+	reserve(NUMBER_CHARS);
+	size = format_real(buffer.get() + size, value) - buffer.get();
+}
+
+void OutputBuffer::flush(void)
+{
+	if (size == 0)
+		return;
+	stream.write(buffer.get(), size);
+	stream.flush();
+	size = 0;
+}
\ No newline at end of file
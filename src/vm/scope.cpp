@@ -1,6 +1,6 @@
 #include "scope.h"
 
-std::unordered_map<std::string_view, std::shared_ptr<Variable>>::iterator Scope::find_variable(std::string_view name, bool local_only)
+std::unordered_map<SymbolId, std::shared_ptr<Variable>>::iterator Scope::find_variable(SymbolId name, bool local_only)
 {
 	auto it = variables.find(name);
 	if (it != variables.end())
@@ -10,40 +10,109 @@ std::unordered_map<std::string_view, std::shared_ptr<Variable>>::iterator Scope:
 	return variables.end();
 }
 
-uint8_t Scope::find_variable_index(std::string name)
+std::optional<uint8_t> Scope::find_variable_index(SymbolId name)
 {
 	auto it = variable_indices.find(name);
 	if (it != variable_indices.end())
 		return it->second;
 	if (parent)
 		return parent->find_variable_index(name);
-	
-	// just in case of a bug
-	throw std::runtime_error("variable `" + name + "` not found");
+	return std::nullopt;
 }
 
-MultiRange<FuncImplementations::const_iterator> Scope::get_function_implementations(std::string_view name)
+std::vector<Function *> Scope::get_function_implementations(SymbolId name)
 {
-	auto it = function_table.get_implementations(name);
-	MultiRange<FuncImplementations::const_iterator> range(it.first, it.second);
-	if (parent)
+	std::vector<Function *> implementations;
+	for (Scope * s = this; s; s = s->parent.get())
+		if (auto * functions = s->function_table.get_implementations(name))
+			for (auto & function : *functions)
+				implementations.push_back(function.get());
+	return implementations;
+}
+
+size_t Scope::count_function_implementations(SymbolId name)
+{
+	return overload_set(name).implementations;
+}
+
+Function * Scope::find_function(SymbolId signature)
+{
+	for (Scope * s = this; s; s = s->parent.get())
+		if (Function * function = s->function_table.find_function(signature))
+			return function;
+	return nullptr;
+}
+
+Scope::OverloadSet & Scope::overload_set(SymbolId name)
+{
+	OverloadSet & set = overloads[name];
+	uint64_t declarations = FunctionTable::declarations.load(std::memory_order_relaxed);
+	if (set.declarations == declarations)
+		return set;
+	set.declarations = declarations;
+
+	// Implementations are never removed, so their count tells whether new ones were declared
+	size_t implementations = 0;
+	for (Scope * s = this; s; s = s->parent.get())
+		if (auto * functions = s->function_table.get_implementations(name))
+			implementations += functions->size();
+	if (set.implementations != implementations)
 	{
-		auto parent_range = parent->get_function_implementations(name);
-		range.add_range(parent_range);
+		set.calls.clear();
+		set.implementations = implementations;
+	}
+	return set;
+}
+
+const OverloadResolution & Scope::resolve_call(SymbolId name, std::span<const MathObjType> argument_types)
+{
+	OverloadSet & set = overload_set(name);
+
+	std::string key;
+	for (const MathObjType & type : argument_types)
+		key.push_back((char)((type.type + 1) * 2 + type.is_const));
+
+	auto [it, inserted] = set.calls.try_emplace(std::move(key));
+	OverloadResolution & resolution = it->second;
+	if (!inserted)
+		return resolution;
+
+	// The most specific of the implementations which the arguments can be converted to
+	// (ambiguous if several of them are equally specific)
+	resolution = { ResolutionStatus::R_NO_MATCH, nullptr };
+	int best_specificity = -1;
+	for (Function * func : get_function_implementations(name))
+	{
+		auto & params = func->parameters;
+		if (params.size() != argument_types.size())
+			continue;
+
+		int specificity = 0;
+		size_t i = 0;
+		for (; i < params.size() && can_convert(argument_types[i], params[i].second); ++i)
+			specificity += calculate_specificity(argument_types[i], params[i].second);
+		if (i < params.size())
+			continue;
+
+		if (specificity > best_specificity)
+		{
+			resolution = { ResolutionStatus::R_MATCH, func };
+			best_specificity = specificity;
+		}
+		else if (specificity == best_specificity)
+			resolution.status = ResolutionStatus::R_AMBIGUOUS;
 	}
-	return range;
+	return resolution;
 }
 
-uint8_t Scope::find_function_index(std::string name)
+std::optional<uint8_t> Scope::find_function_index(SymbolId signature)
 {
-	auto it = function_indices.find(name);
+	auto it = function_indices.find(signature);
 	if (it != function_indices.end())
 		return it->second;
 	if (parent)
-		return parent->find_function_index(name);
-	
-	// just in case of a bug
-	throw std::runtime_error("function `" + name + "` not found");
+		return parent->find_function_index(signature);
+	return std::nullopt;
 }
 
 void push_scope(std::shared_ptr<Scope> & scope)
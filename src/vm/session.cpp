@@ -0,0 +1,112 @@
+#include "session.h"
+
+std::optional<uint8_t> Session::add_constant(std::shared_ptr<MathObj> constant, ConstantKey key)
+{
+	uint8_t index;
+	if (!free_constants.empty())
+	{
+		index = free_constants.back();
+		free_constants.pop_back();
+		(*constants)[index] = std::move(constant);
+	}
+	else if (constants->size() < UINT8_MAX)
+	{
+		index = constants->size();
+		constants->push_back(std::move(constant));
+	}
+	else
+		return std::nullopt;
+
+	constant_indices[key] = index;
+	input_constants.set(index);
+	return index;
+}
+
+std::optional<uint8_t> Session::add_variable(std::shared_ptr<Variable> variable)
+{
+	uint8_t index;
+	if (!free_variables.empty())
+	{
+		index = free_variables.back();
+		free_variables.pop_back();
+		(*variables)[index] = std::move(variable);
+	}
+	else if (variables->size() < UINT8_MAX)
+	{
+		index = variables->size();
+		variables->push_back(std::move(variable));
+	}
+	else
+		return std::nullopt;
+
+	input_variables.set(index);
+	return index;
+}
+
+void Session::release_input(void)
+{
+	for (size_t index = 0; index < constants->size(); index++)
+	{
+		if (!input_constants.test(index))
+			continue;
+		auto & constant = (*constants)[index];
+		constant_indices.erase(constant_key(constant));
+		constant = nullptr;
+		free_constants.push_back(index);
+	}
+	for (size_t index = 0; index < variables->size(); index++)
+	{
+		if (!input_variables.test(index))
+			continue;
+		(*variables)[index] = nullptr;
+		free_variables.push_back(index);
+	}
+	input_constants.reset();
+	input_variables.reset();
+}
+
+Session::Checkpoint Session::checkpoint(void) const
+{
+	return Checkpoint {
+		constants->size(), variables->size(), functions->size(), operators->size(),
+		input_constants, input_variables,
+		free_constants, free_variables
+	};
+}
+
+void Session::rollback(const Checkpoint & checkpoint)
+{
+	// Entries were added past the end of the tables, or in the slots that were released
+	for (size_t index = checkpoint.constants; index < constants->size(); index++)
+		constant_indices.erase(constant_key((*constants)[index]));
+	for (uint8_t index : checkpoint.free_constants)
+	{
+		auto & constant = (*constants)[index];
+		if (constant)
+			constant_indices.erase(constant_key(constant));
+		constant = nullptr;
+	}
+	constants->resize(checkpoint.constants);
+
+	for (uint8_t index : checkpoint.free_variables)
+		(*variables)[index] = nullptr;
+	variables->resize(checkpoint.variables);
+
+	functions->resize(checkpoint.functions);
+	for (size_t index = checkpoint.operators; index < operators->size(); index++)
+		operator_indices.erase((*operators)[index].first.get());
+	operators->resize(checkpoint.operators);
+
+	input_constants = checkpoint.input_constants;
+	input_variables = checkpoint.input_variables;
+	free_constants = checkpoint.free_constants;
+	free_variables = checkpoint.free_variables;
+}
+
+bool Session::took_at_most_half(const Checkpoint & checkpoint) const
+{
+	size_t constants_taken = input_constants.count() - checkpoint.input_constants.count();
+	size_t variables_taken = input_variables.count() - checkpoint.input_variables.count();
+	return 2 * constants_taken <= UINT8_MAX - checkpoint.constants + checkpoint.free_constants.size()
+		&& 2 * variables_taken <= UINT8_MAX - checkpoint.variables + checkpoint.free_variables.size();
+}
\ No newline at end of file
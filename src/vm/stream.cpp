@@ -0,0 +1,27 @@
+#include <algorithm>
+
+#include "stream.h"
+#include "lexer.h"
+
+StreamBatch StatementScanner::next(void)
+{
+	StreamBatch batch;
+	std::string_view text = source.substr(line_start);
+	Lexer lexer(text, symbols, position - line_start);
+	batch.tokens = lexer.tokenize_statements(batch_tokens);
+	batch.at_end = batch.tokens.size() == 1;
+	size_t end = lexer.get_position();
+
+	// Only the lines of the batch are indexed to report its errors
+	batch.text = text.substr(0, text.find('\n', end));
+	batch.first_line = line;
+
+	// Move past the batch
+	std::string_view scanned = source.substr(position, line_start + end - position);
+	line += std::count(scanned.begin(), scanned.end(), '\n');
+	size_t last_newline = scanned.rfind('\n');
+	if (last_newline != std::string_view::npos)
+		line_start = position + last_newline + 1;
+	position += scanned.length();
+	return batch;
+}
\ No newline at end of file
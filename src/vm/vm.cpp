@@ -1,29 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <thread>
 
 #include "vm.h"
 #include "globals.h"
 #include "error.h"
 #include "semanalyzer.h"
+#include "image.h"
+#include "spscqueue.h"
 
 bool config::print_lexer_output = false;
 bool config::print_parser_output = false;
 bool config::print_compiler_output = false;
+bool config::print_ir_output = false;
 
-void VM::interpret_source(std::string_view source)
+int config::optimization_level = 1;
+bool config::memoize = false;
+bool config::compile_only = false;
+std::string config::prelude;
+bool config::use_cache = true;
+bool config::stream = false;
+bool config::pipeline = false;
+unsigned config::lex_threads = 1;
+bool config::benchmark_lexer = false;
+bool config::benchmark_analyzer = false;
+
+bool VM::interpret_source(std::string_view source)
 {
 	if (config::print_lexer_output)
 		std::cout << ">>>>> Tokens <<<<<\n";
-	Lexer lexer(source);
+	Lexer lexer(source, session.symbols);
+	return interpret_tokens(lexer.tokenize_parallel(config::lex_threads), source);
+}
 
-	Parser parser(lexer);
-	parser.parse_source();
+bool VM::interpret_stream(std::string_view source)
+{
+	StatementScanner scanner(source, session.symbols, STREAM_BATCH_TOKENS);
+	while (true)
+	{
+		if (config::print_lexer_output)
+			std::cout << ">>>>> Tokens <<<<<\n";
+		StreamBatch batch = scanner.next();
+		if (!interpret_batch(batch))
+			return false;
+		if (batch.at_end)
+			return true;
+	}
+}
+
+bool VM::interpret_pipelined(std::string_view source)
+{
+	// The last batch pushed by each thread has `at_end` set. After an error, the threads stop
+	// scanning and parsing, and the batches already queued are dropped
+	SpscQueue<StreamBatch> scanned(PIPELINE_DEPTH), parsed(PIPELINE_DEPTH);
+	std::atomic<bool> stopping = false;
+
+	// Names are interned by the scanning thread only (see symbol.h)
+	std::thread scanning([&]
+	{
+		StatementScanner scanner(source, session.symbols, STREAM_BATCH_TOKENS);
+		bool at_end = false;
+		while (!at_end)
+		{
+			StreamBatch batch;
+			try
+			{
+				if (!stopping.load(std::memory_order_relaxed))
+					batch = scanner.next();
+			}
+			catch (...)
+			{
+				batch.failure = std::current_exception();
+			}
+			batch.errors = ErrorHandler::take_errors();
+			at_end = batch.at_end = batch.at_end || batch.tokens.empty();
+			scanned.push(std::move(batch));
+		}
+	});
+
+	std::thread parsing([&]
+	{
+		bool at_end = false;
+		while (!at_end)
+		{
+			StreamBatch batch = scanned.pop();
+			at_end = batch.at_end;
+			if (!batch.tokens.empty() && !batch.failure && !stopping.load(std::memory_order_relaxed))
+			{
+				try
+				{
+					batch.parser = std::make_unique<Parser>(std::move(batch.tokens), batch.text, session.operator_table);
+					batch.parser->parse_source();
+				}
+				catch (...)
+				{
+					batch.failure = std::current_exception();
+				}
+				for (auto & err : ErrorHandler::take_errors())
+					batch.errors.push_back(std::move(err));
+			}
+			parsed.push(std::move(batch));
+		}
+	});
+
+	bool interpreted = true, at_end = false;
+	std::exception_ptr failure;
+	while (!at_end)
+	{
+		StreamBatch batch = parsed.pop();
+		at_end = batch.at_end;
+		if (!interpreted || failure)
+			continue;
 
-	if (ErrorHandler::has_errors())
+		if (batch.failure)
+			failure = batch.failure;
+		else if (batch.parser)
+		{
+			try
+			{
+				interpreted = interpret_batch(batch);
+			}
+			catch (...)
+			{
+				failure = std::current_exception();
+			}
+		}
+		if (!interpreted || failure)
+			stopping.store(true, std::memory_order_relaxed);
+	}
+
+	scanning.join();
+	parsing.join();
+	if (failure)
+		std::rethrow_exception(failure);
+	return interpreted;
+}
+
+bool VM::interpret_batch(StreamBatch & batch)
+{
+	first_line = batch.first_line;
+	bool interpreted;
+	if (batch.parser)
 	{
-		ErrorHandler::report_errors(source);
-		return;
+		ErrorHandler::push_errors(std::move(batch.errors));
+		interpreted = interpret_parsed(*batch.parser, batch.text);
 	}
+	else
+		interpreted = interpret_tokens(std::move(batch.tokens), batch.text);
+	first_line = 1;
+	return interpreted;
+}
+
+bool VM::interpret_tokens(std::vector<Token> tokens, std::string_view source)
+{
+	Parser parser(std::move(tokens), source, session.operator_table);
+	parser.parse_source();
+	return interpret_parsed(parser, source);
+}
+
+bool VM::interpret_parsed(Parser & parser, std::string_view source)
+{
+	if (has_errors(source))
+		return false;
 
 	if (config::print_parser_output)
 	{
@@ -31,52 +173,214 @@ void VM::interpret_source(std::string_view source)
 		parser.get_ast().print();
 	}
 
+	AST & ast = parser.get_ast();
+	if (!interactive)
+		return interpret_statements(ast, source, nullptr);
+
+	// The statements of an interactive input run in parts if they need more entries than the tables
+	// of the session have left, as the entries of a part are released once it has run. The parts
+	// keep the size of the last one that fitted (the statements of a stream tend to look alike)
+	std::vector<NodeIndex> statements = std::move(ast.statements);
+	bool interpreted = true;
+	for (size_t begin = 0; begin < statements.size() && interpreted; )
+	{
+		size_t end = begin + std::min(part_statements, statements.size() - begin);
+		ast.statements.assign(statements.begin() + begin, statements.begin() + end);
+		size_t fitting = end - begin;
+		if (interpret_statements(ast, source, &fitting))
+		{
+			begin = end;
+			part_statements = std::max(part_statements, fitting);
+		}
+		else if (fitting < end - begin)
+			part_statements = fitting;
+		else
+			interpreted = false;
+	}
+	ast.statements = std::move(statements);
+	return interpreted;
+}
+
+bool VM::interpret_statements(AST & ast, std::string_view source, size_t * fitting)
+{
+	// What the statements add to the tables and to the global scope is dropped to run them in parts
+	bool splittable = fitting && *fitting > 1;
+	Session::Checkpoint checkpoint;
+	Scope global_scope;
+	size_t scopes = current_scope->children.size();
+	if (fitting)
+		checkpoint = session.checkpoint();
+	if (splittable)
+		global_scope = *current_scope;
+	auto split = [&](size_t statements)
+	{
+		ErrorHandler::discard_errors();
+		session.rollback(checkpoint);
+		*current_scope = std::move(global_scope);
+		*fitting = std::clamp<size_t>(statements, 1, *fitting - 1);
+		return false;
+	};
+
 	SemanticAnalyzer semantic_analyzer(
-		parser.get_ast(),
-		std::move(parser.operators),
+		ast,
+		session.operator_table,
+		session.symbols,
 		current_scope
 	);
 	semantic_analyzer.analyze_source();
 
-	if (ErrorHandler::has_errors())
-	{
-		ErrorHandler::report_errors(source);
-		return;
-	}
+	// The analyzer only takes scopes for function declarations, and the other entries are taken by
+	// the compiler
+	if (splittable && ErrorHandler::has_errors() && current_scope->children.size() >= UINT8_MAX)
+		return split(*fitting / 2);
+	if (has_errors(source))
+		return false;
 
 	Compiler compiler(
-		parser.get_ast(),
-		parser.operators,
-		current_scope,
-		constants, variables, functions, operators
+		ast,
+		session,
+		current_scope
 	);
 	compiler.compile_source();
 	chunk = compiler.chunk;
-	chunk->ip = chunk->bytecode().begin();
+	chunk->ip = chunk->bytecode().data();
+
+	// Debug output shows every function, the AST of a REPL input is released once it has run
+	// (while later inputs can call its functions) and a compiled program holds every function,
+	// so nothing is left for later in those cases
+	bool compile_only = config::compile_only || ahead_of_time;
+	if (interactive || config::print_ir_output || config::print_compiler_output || compile_only)
+		compiler.compile_pending_functions();
+
+	// The statements before the first one whose entries did not fit are tried alone
+	if (splittable && ErrorHandler::has_errors() && compiler.full_table_node)
+	{
+		uint32_t position = compiler.full_table_node->start_position;
+		auto statement = std::upper_bound(ast.statements.begin(), ast.statements.end(), position,
+			[&](uint32_t start, NodeIndex statement) { return start < ast.node(statement).start_position; });
+		return split(statement - ast.statements.begin() - 1);
+	}
+	if (has_errors(source))
+	{
+		if (interactive)
+			session.release_input();
+		return false;
+	}
+	if (fitting && session.took_at_most_half(checkpoint)
+		&& 2 * (current_scope->children.size() - scopes) <= UINT8_MAX - scopes)
+		*fitting *= 2;
 
-	if (ErrorHandler::has_errors())
+	if (config::print_ir_output)
 	{
-		ErrorHandler::report_errors(source);
-		return;
+		std::cout << "\n>>>>> IR <<<<<\n";
+		compiler.dump_ir();
 	}
-	
+
 	if (config::print_compiler_output)
 	{
 		std::cout << "\n>>>>> Bytecode <<<<<\n";
 		compiler.disassemble();
 	}
 
+	if (compile_only)
+		return true;
+
+	this->compiler = &compiler;
+	this->source = source;
+	OutputBuffer::active = &output;
+	run();
+	output.flush();
+	this->compiler = nullptr;
+	if (interactive)
+		session.release_input(); // The main chunk of an input is not run again
+	return true;
+}
+
+bool VM::has_errors(std::string_view source)
+{
+	if (!ErrorHandler::has_errors())
+		return false;
+
+	if (quiet)
+		ErrorHandler::discard_errors();
+	else
+		ErrorHandler::report_errors(source, first_line);
+	return true;
+}
+
+bool VM::compile_image(std::string_view source, std::string & image, bool quiet)
+{
+	// Some limits are only reached when every function is compiled (they throw)
+	ahead_of_time = true;
+	this->quiet = quiet;
+	bool compiled = false;
+	try
+	{
+		compiled = interpret_source(source);
+	}
+	catch (const std::exception &)
+	{
+		ErrorHandler::discard_errors();
+		ahead_of_time = this->quiet = false;
+		if (!quiet)
+			throw;
+	}
+	ahead_of_time = this->quiet = false;
+	if (!compiled)
+		return false;
+
+	std::ostringstream out;
+	save_image(out);
+	image = std::move(out).str();
+	return true;
+}
+
+void VM::save_image(std::ostream & out)
+{ write_image(out, session, *chunk, *current_scope); }
+
+void VM::save_snapshot(std::ostream & out, const std::string & printed)
+{
+	// Nothing is left to run
+	Chunk main("<main>");
+	main.bytes.push_back(OpCode::OP_RETURN);
+	write_image(out, session, main, *current_scope, &printed);
+}
+
+void VM::load_image(std::string_view image)
+{
+	try
+	{
+		chunk = ::load_image(image, session, current_scope, restored_output);
+	}
+	catch (const std::exception &)
+	{
+		// Nothing of a partly loaded image is kept
+		session = Session();
+		current_scope = std::make_shared<Scope>();
+		throw;
+	}
+}
+
+void VM::execute(void)
+{
+	// Every function is compiled already
+	chunk->ip = chunk->bytecode().data();
+	OutputBuffer::active = &output;
+	if (!restored_output.empty())
+		output.write(restored_output);
+	restored_output = {};
 	run();
+	output.flush();
 }
 
 void VM::run(void)
 {
 	// Define helper macros for reading bytecode
 	#define READ_BYTE()				(*(chunk->ip++))
-	#define READ_CONSTANT()			((*constants)[READ_BYTE()])
-	#define READ_VARIABLE()			((*variables)[READ_BYTE()])
-	#define READ_FUNCTION()			((*functions)[READ_BYTE()])
-	#define READ_OPERATOR()			((*operators)[READ_BYTE()].first)
+	#define READ_CONSTANT()			((*session.constants)[READ_BYTE()])
+	#define READ_VARIABLE()			((*session.variables)[READ_BYTE()])
+	#define READ_FUNCTION()			((*session.functions)[READ_BYTE()])
+	#define READ_OPERATOR()			((*session.operators)[READ_BYTE()].first)
 
 	while (true)
 	{
@@ -112,13 +416,30 @@ void VM::run(void)
 			{
 				auto custom_function = std::static_pointer_cast<CustomFunction>(function);
 
+				CallFrame frame { custom_function, false, {} };
+				if (call_memoized(frame))
+					break;
+
+				// The body is compiled on the first call
+				if (!custom_function->chunk)
+				{
+					compiler->compile_function(custom_function);
+					if (ErrorHandler::has_errors())
+					{
+						output.flush(); // Keep the output before the errors
+						ErrorHandler::report_errors(source, first_line);
+						return;
+					}
+				}
+				frames.push_back(std::move(frame));
+
 				// Enter function scope
 				enter_function(current_scope, custom_function);
 
 				// Set the current chunk to the function's chunk
 				custom_function->chunk->parent = chunk;
 				chunk = custom_function->chunk;
-				chunk->ip = chunk->bytecode().begin();
+				chunk->ip = chunk->bytecode().data();
 
 				break;
 			}
@@ -131,6 +452,7 @@ void VM::run(void)
 		case OpCode::OP_LEAVE_FUNCTION:
 			// Push None to the stack
 			stack.push(std::shared_ptr<None>());
+			frames.pop_back();
 			// Leave function scope
 			pop_function(current_scope);
 			// Set the current chunk to the parent chunk
@@ -215,6 +537,7 @@ void VM::run(void)
 			{
 				// Push None to the stack
 				stack.push(std::shared_ptr<None>());
+				frames.pop_back();
 
 				// Leave function scope
 				pop_function(current_scope);
@@ -226,20 +549,71 @@ void VM::run(void)
 			// If there is no parent chunk, then we are in the global scope and at the end of the program
 			return;
 		case OpCode::OP_RETURN_VALUE:
+		{
+			// Return the value itself rather than a variable of the function
+			auto value = get_value(stack.top());
+			stack.pop();
+			stack.push(value);
+
+			auto & frame = frames.back();
+			if (frame.memoize)
+				frame.function->memo->insert(std::move(frame.memo_key), value);
+			frames.pop_back();
+
 			// Leave function scope
 			pop_function(current_scope);
 			// Set the current chunk to the parent chunk
 			chunk = chunk->parent;
 			break;
+		}
 	}
 	}
 }
 
+bool VM::call_memoized(CallFrame & frame)
+{
+	auto & function = frame.function;
+	// A pure function without a result has no effect at all, but it is still called
+	if (!config::memoize || !function->is_pure || function->return_type.type == MOT::MO_NONE)
+		return false;
+
+	// Look at the arguments pushed by the caller
+	std::vector<std::shared_ptr<MathObj>> arguments(function->arity());
+	for (size_t i = arguments.size(); i-- > 0;)
+	{
+		arguments[i] = stack.top();
+		stack.pop();
+	}
+	if (!MemoTable::make_key(arguments, frame.memo_key))
+	{
+		for (auto & argument : arguments)
+			stack.push(argument);
+		return false;
+	}
+
+	if (!function->memo)
+		function->memo = std::make_unique<MemoTable>();
+
+	// Skip the call entirely
+	if (auto result = function->memo->find(frame.memo_key))
+	{
+		stack.push(result);
+		return true;
+	}
+
+	for (auto & argument : arguments)
+		stack.push(argument);
+	frame.memoize = true;
+	return false;
+}
+
 std::shared_ptr<MathObj> get_value(std::shared_ptr<MathObj> & obj)
 {
 	if (obj->type().type == MOT::MO_VARIABLE)
 	{
 		auto variable = std::static_pointer_cast<Variable>(obj);
+		if (!variable->value)
+			throw std::runtime_error("variable `" + variable->name + "` is used before it is set");
 		return variable->value;
 	}
 	return obj;
@@ -0,0 +1,77 @@
+# Compile a script, overwrite one byte of the compiled program (counted from its end, where the
+# bytecode of the main chunk is) and run it again. The program is run from its `.mthlc` file, or
+# with CACHE from the cache, which must drop the entry and run the script from the source
+#   -DMATHLANG=<interpreter> -DSCRIPT=<script> -DEXPECTED=<file> -DWORK=<directory>
+#   -DFROM_END=<offset> -DBYTE=<value> [-DCACHE=ON] [-DEXIT_CODE=<status>]
+
+if (NOT EXIT_CODE)
+	set(EXIT_CODE 0)
+endif()
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+get_filename_component(name "${SCRIPT}" NAME)
+file(COPY "${SCRIPT}" DESTINATION "${WORK}")
+set(script "${WORK}/${name}")
+set(cache "${WORK}/cache")
+
+function(run_script file)
+	execute_process(
+		COMMAND ${CMAKE_COMMAND} -E env MATHLANG_CACHE_DIR=${cache} "${MATHLANG}" ${ARGN} -f "${file}"
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE errors
+		RESULT_VARIABLE result
+		)
+	set(output "${output}${errors}" PARENT_SCOPE)
+	set(result "${result}" PARENT_SCOPE)
+endfunction()
+
+function(check expected_output expected_result)
+	if (NOT "${output}" STREQUAL "${expected_output}")
+		message(FATAL_ERROR "unexpected output:\n${output}\nexpected:\n${expected_output}")
+	endif()
+	if (NOT "${result}" STREQUAL "${expected_result}")
+		message(FATAL_ERROR "exited with ${result} instead of ${expected_result}")
+	endif()
+endfunction()
+
+# Byte values other than 0 (which CMake strings cannot hold)
+function(overwrite_byte file)
+	file(SIZE "${file}" size)
+	math(EXPR offset "${size} - ${FROM_END}")
+	string(ASCII ${BYTE} byte)
+	file(WRITE "${WORK}/byte" "${byte}")
+	execute_process(
+		COMMAND dd if=${WORK}/byte of=${file} bs=1 seek=${offset} conv=notrunc status=none
+		RESULT_VARIABLE result
+		)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "unable to overwrite `${file}`")
+	endif()
+endfunction()
+
+file(READ "${EXPECTED}" expected)
+if (CACHE)
+	run_script("${script}")
+	check("${expected}" 0)
+
+	file(GLOB entries "${cache}/*")
+	list(LENGTH entries count)
+	if (NOT count EQUAL 1)
+		message(FATAL_ERROR "expected a single cached program, found ${count}")
+	endif()
+	overwrite_byte("${entries}")
+
+	# The corrupted entry is replaced, so both runs give the output of the script
+	foreach(run 1 2)
+		run_script("${script}")
+		check("${expected}" ${EXIT_CODE})
+	endforeach()
+else()
+	run_script("${script}" --no-cache -c)
+	check("" 0)
+	string(REGEX REPLACE "\\.mthl$" ".mthlc" image "${script}")
+	overwrite_byte("${image}")
+	run_script("${image}" --no-cache)
+	check("${expected}" ${EXIT_CODE})
+endif()
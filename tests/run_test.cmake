@@ -0,0 +1,23 @@
+# Run a script with the interpreter and compare what it writes (the standard output, then
+# the errors) and its exit status with the expected ones
+#   -DMATHLANG=<interpreter> -DSCRIPT=<script> -DEXPECTED=<file> [-DOPTIONS=<options>] [-DEXIT_CODE=<status>]
+
+separate_arguments(OPTIONS)
+if (NOT DEFINED EXIT_CODE)
+	set(EXIT_CODE 0)
+endif()
+
+execute_process(
+	COMMAND "${MATHLANG}" --no-cache ${OPTIONS} -f "${SCRIPT}"
+	OUTPUT_VARIABLE output
+	ERROR_VARIABLE errors
+	RESULT_VARIABLE result
+	)
+file(READ "${EXPECTED}" expected)
+
+if (NOT "${output}${errors}" STREQUAL "${expected}")
+	message(FATAL_ERROR "unexpected output:\n${output}${errors}\nexpected:\n${expected}")
+endif()
+if (NOT "${result}" STREQUAL "${EXIT_CODE}")
+	message(FATAL_ERROR "exited with ${result} instead of ${EXIT_CODE}")
+endif()